@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "alias_filter.h"
+#include "alloc.h"
+#include "stats.h"
+
+static const char *const trampolines[] = { "__pfx_", "__cfi_" };
+
+static int add_prefix(struct alias_filter *f, size_t *cap, const char *name, size_t len,
+		      uint32_t rule)
+{
+	struct filter_prefix *tmp;
+
+	if (f->nprefixes == *cap) {
+		tmp = kas_realloc(f->prefixes, *cap * sizeof(*tmp),
+				  (*cap ? *cap * 2 : 16) * sizeof(*tmp));
+		if (!tmp)
+			return 0;
+		f->prefixes = tmp;
+		*cap = *cap ? *cap * 2 : 16;
+	}
+	f->prefixes[f->nprefixes].name = name;
+	f->prefixes[f->nprefixes].name_len = len;
+	f->prefixes[f->nprefixes].rule = rule;
+	f->nprefixes++;
+	return 1;
+}
+
+static int add_rule(struct alias_filter *f, size_t *cap, const char *p, size_t len)
+{
+	struct dup_entry *entry;
+	uint32_t rule = FILTER_ALLOW;
+
+	if (*p == '!') {
+		rule = FILTER_DENY;
+		p++;
+		len--;
+	}
+	if (rule == FILTER_ALLOW)
+		f->has_allow = true;
+
+	if (len && p[len - 1] == '*')
+		return add_prefix(f, cap, p, len - 1, rule);
+
+	entry = dup_table_insert(&f->names, p, len, name_hash(p, len));
+	if (!entry)
+		return 0;
+	/* the last rule for a name counts */
+	entry->first = rule;
+	return 1;
+}
+
+static int prefix_cmp(const void *a, const void *b)
+{
+	const struct filter_prefix *pa = a, *pb = b;
+	unsigned char ca = pa->name_len ? pa->name[0] : 0;
+	unsigned char cb = pb->name_len ? pb->name[0] : 0;
+
+	return ca - cb;
+}
+
+/* Buckets the prefixes by first byte; an empty prefix ("*") sits in bucket 0. */
+static void index_prefixes(struct alias_filter *f)
+{
+	size_t i, b = 0;
+
+	if (f->nprefixes)
+		qsort(f->prefixes, f->nprefixes, sizeof(*f->prefixes), prefix_cmp);
+	for (i = 0; i < f->nprefixes; i++) {
+		while (b <= (unsigned char)(f->prefixes[i].name_len ? f->prefixes[i].name[0] : 0))
+			f->bucket[b++] = i;
+	}
+	while (b <= 256)
+		f->bucket[b++] = f->nprefixes;
+}
+
+static int parse_rules(struct alias_filter *f)
+{
+	const char *p = f->buf, *end = f->buf + f->len, *eol;
+	size_t cap = 0, len;
+
+	for (; p < end; p = eol + 1) {
+		eol = memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		while (p < eol && (*p == ' ' || *p == '\t'))
+			p++;
+		for (len = eol - p; len && (p[len - 1] == ' ' || p[len - 1] == '\t' ||
+					    p[len - 1] == '\r'); len--)
+			;
+		if (!len || *p == '#')
+			continue;
+		if (!add_rule(f, &cap, p, len))
+			return 0;
+	}
+
+	index_prefixes(f);
+	return 1;
+}
+
+/*
+ * Maps the alias list at path and compiles its rules. Returns 1 on
+ * success, 0 if memory ran out and -1 if the file cannot be read. The
+ * policy flags are left as they are.
+ */
+int alias_filter_load(struct alias_filter *f, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return -1;
+	}
+	if (!dup_table_init(&f->names, 0)) {
+		close(fd);
+		return 0;
+	}
+	if (!st.st_size) {
+		close(fd);
+		index_prefixes(f);
+		return 1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		dup_table_free(&f->names);
+		return errno == ENOMEM ? 0 : -1;
+	}
+
+	kas_stats.input_bytes += st.st_size;
+	f->buf = map;
+	f->len = st.st_size;
+
+	if (!parse_rules(f)) {
+		alias_filter_free(f);
+		return 0;
+	}
+	return 1;
+}
+
+static inline bool is_text(char stype)
+{
+	return stype == 't' || stype == 'T' || stype == 'W';
+}
+
+static uint32_t match_rules(struct alias_filter *f, const char *name, size_t len)
+{
+	const struct filter_prefix *p;
+	struct dup_entry *entry;
+	uint32_t i, rule = 0;
+
+	if (f->names.used) {
+		entry = dup_table_find(&f->names, name, len, name_hash(name, len));
+		if (entry)
+			return entry->first;
+	}
+
+	/* the catch-all "*" first, then the prefixes sharing the first byte */
+	for (i = f->bucket[0]; i < f->bucket[1]; i++)
+		rule |= f->prefixes[i].rule;
+	if (len) {
+		for (i = f->bucket[(unsigned char)name[0]];
+		     i < f->bucket[(unsigned char)name[0] + 1]; i++) {
+			p = &f->prefixes[i];
+			if (p->name_len <= len && memcmp(p->name, name, p->name_len) == 0)
+				rule |= p->rule;
+		}
+	}
+	return rule;
+}
+
+/* Whether a symbol of this name and type may get an alias, the trampoline rule aside. */
+bool alias_filter_allows(struct alias_filter *f, const char *name, size_t len, char stype)
+{
+	uint32_t rule;
+
+	if (f->text_only && !is_text(stype))
+		return false;
+	if (!f->buf)
+		return true;
+
+	rule = match_rules(f, name, len);
+	if (rule & FILTER_DENY)
+		return false;
+	return rule || !f->has_allow;
+}
+
+/* Length of the trampoline prefix name starts with, 0 if none. */
+static size_t trampoline_len(const char *name, size_t len)
+{
+	size_t i, n;
+
+	for (i = 0; i < sizeof(trampolines) / sizeof(trampolines[0]); i++) {
+		n = strlen(trampolines[i]);
+		if (len > n && memcmp(name, trampolines[i], n) == 0)
+			return n;
+	}
+	return 0;
+}
+
+/*
+ * Clears the alias of every numbered item the filter rejects. With
+ * skip_pfx, the __pfx_ and __cfi_ symbols of a function that still has
+ * aliases lose theirs: they sit at a fixed offset before it. Returns 0
+ * if memory ran out.
+ */
+int alias_filter_apply(struct alias_filter *f, struct item_list *list)
+{
+	struct dup_table aliased;
+	struct item *item;
+	size_t i, n;
+	int ret = 1;
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (item->alias &&
+		    !alias_filter_allows(f, item->symb_name, item->name_len, item->stype))
+			item->alias = 0;
+	}
+
+	if (!f->skip_pfx)
+		return 1;
+
+	if (!dup_table_init(&aliased, 0))
+		return 0;
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (item->alias && !trampoline_len(item->symb_name, item->name_len) &&
+		    !dup_table_insert(&aliased, item->symb_name, item->name_len, item->hash)) {
+			ret = 0;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < list->count && aliased.used; i++) {
+		item = &list->items[i];
+		if (!item->alias)
+			continue;
+		n = trampoline_len(item->symb_name, item->name_len);
+		if (n && dup_table_find(&aliased, item->symb_name + n, item->name_len - n,
+					name_hash(item->symb_name + n, item->name_len - n)))
+			item->alias = 0;
+	}
+out:
+	dup_table_free(&aliased);
+	return ret;
+}
+
+void alias_filter_free(struct alias_filter *f)
+{
+	if (f->buf)
+		munmap((void *)f->buf, f->len);
+	dup_table_free(&f->names);
+	kas_free(f->prefixes);
+	f->buf = NULL;
+	f->prefixes = NULL;
+	f->nprefixes = 0;
+}
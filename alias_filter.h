@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef ALIAS_FILTER_H
+#define ALIAS_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "item_list.h"
+#include "duplicates_list.h"
+
+#define FILTER_ALLOW 1
+#define FILTER_DENY 2
+
+/* A "name*" rule of the alias list; name points into the mapped file. */
+struct filter_prefix {
+	const char	*name;
+	uint32_t	name_len;
+	uint32_t	rule;
+};
+
+/*
+ * Which duplicates get an alias. The numbering is not affected: a symbol
+ * left without alias keeps its ordinal, so the other aliases of its name
+ * do not move.
+ *
+ * An alias list has one rule per line, a name or a name prefix ending in
+ * '*', denying the alias when it starts with '!'; '#' starts a comment.
+ * Exact names are looked up in a hash table and prefixes are bucketed by
+ * first byte. An exact rule wins over the prefixes and a denying prefix
+ * over an allowing one. Once there is an allowing rule, names matching
+ * none are denied.
+ */
+struct alias_filter {
+	bool			text_only;	/* only t, T and W symbols */
+	bool			skip_pfx;	/* no __pfx_/__cfi_ alias when the function has one */
+	bool			has_allow;
+	const char		*buf;
+	size_t			len;
+	struct dup_table	names;		/* entry->first is the rule */
+	struct filter_prefix	*prefixes;	/* sorted by first byte */
+	size_t			nprefixes;
+	uint32_t		bucket[257];	/* prefixes starting with byte b */
+};
+
+int alias_filter_load(struct alias_filter *f, const char *path);
+bool alias_filter_allows(struct alias_filter *f, const char *name, size_t len, char stype);
+int alias_filter_apply(struct alias_filter *f, struct item_list *list);
+void alias_filter_free(struct alias_filter *f);
+
+static inline bool alias_filter_active(const struct alias_filter *f)
+{
+	return f->text_only || f->skip_pfx || f->buf;
+}
+#endif
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "alias_state.h"
+#include "alloc.h"
+
+static char *read_file(const char *path)
+{
+	size_t len = 0, cap = 0;
+	char *buf = NULL, *tmp;
+	ssize_t n;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	for (;;) {
+		if (len + 1 >= cap) {
+			tmp = kas_realloc(buf, cap, cap ? cap * 2 : 1 << 17);
+			if (!tmp)
+				break;
+			buf = tmp;
+			cap = cap ? cap * 2 : 1 << 17;
+		}
+		n = read(fd, buf + len, cap - len - 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			if (!n) {
+				buf[len] = '\0';
+				close(fd);
+				return buf;
+			}
+			break;
+		}
+		len += n;
+	}
+
+	kas_free(buf);
+	close(fd);
+	return NULL;
+}
+
+static bool next_token(char **p, char **token)
+{
+	char *s = *p;
+
+	while (*s == ' ' || *s == '\n')
+		s++;
+	if (!*s)
+		return false;
+
+	*token = s;
+	while (*s && *s != ' ' && *s != '\n')
+		s++;
+	if (*s)
+		*s++ = '\0';
+	*p = s;
+	return true;
+}
+
+static bool next_number(char **p, uint64_t *value, int base)
+{
+	char *token, *end;
+
+	if (!next_token(p, &token))
+		return false;
+
+	*value = strtoull(token, &end, base);
+	return !*end;
+}
+
+static bool parse_state(struct alias_state *st)
+{
+	uint64_t version, ngroups, count;
+	struct alias_group *group;
+	struct dup_entry *entry;
+	char *p = st->data;
+	char *token;
+	size_t i;
+
+	if (!next_token(&p, &token) || strcmp(token, ALIAS_STATE_MAGIC) ||
+	    !next_number(&p, &version, 10) || version != ALIAS_STATE_VERSION ||
+	    !next_number(&p, &st->symbols, 10) || !next_number(&p, &st->checksum, 16) ||
+	    !next_number(&p, &ngroups, 10) || ngroups > UINT32_MAX)
+		return false;
+
+	st->groups = kas_malloc(ngroups * sizeof(struct alias_group) + 1);
+	if (!st->groups || !dup_table_init(&st->names, ngroups))
+		return false;
+
+	for (i = 0; i < ngroups; i++) {
+		if (!next_token(&p, &token) || !next_number(&p, &count, 10) ||
+		    count < 2 || count > UINT32_MAX)
+			return false;
+
+		entry = dup_table_insert(&st->names, token, strlen(token),
+					 name_hash(token, strlen(token)));
+		if (!entry || entry->count)
+			return false;
+
+		entry->count = 1;
+		entry->first = i;
+		group = &st->groups[i];
+		group->name = token;
+		group->count = count;
+		group->used = 0;
+	}
+
+	st->ngroups = ngroups;
+	return !next_token(&p, &token);
+}
+
+/*
+ * Returns 0 only on allocation failure. A missing, stale or malformed
+ * file simply leaves the state unloaded; it is rewritten at the end of
+ * the run.
+ */
+int alias_state_load(struct alias_state *st, const char *path)
+{
+	memset(st, 0, sizeof(*st));
+	st->data = read_file(path);
+	if (!st->data)
+		return errno != ENOMEM;
+
+	if (parse_state(st)) {
+		st->loaded = true;
+		return 1;
+	}
+
+	alias_state_free(st);
+	memset(st, 0, sizeof(*st));
+	return 1;
+}
+
+struct alias_group *alias_state_group(struct alias_state *st, const char *name, size_t len,
+				      uint32_t hash)
+{
+	struct dup_entry *entry;
+
+	if (!st->loaded)
+		return NULL;
+
+	entry = dup_table_find(&st->names, name, len, hash);
+	return entry ? &st->groups[entry->first] : NULL;
+}
+
+/* Ordinal of the next occurrence of the group's name. */
+uint32_t alias_state_ordinal(struct alias_state *st, struct alias_group *group)
+{
+	if (group->used == group->count)
+		st->diverged = true;
+	return ++group->used;
+}
+
+int alias_state_log(struct alias_state *st, const char *name, size_t len)
+{
+	size_t cap = st->log_cap ? st->log_cap * 2 : 4096;
+	struct alias_record *log;
+
+	if (st->log_len == st->log_cap) {
+		log = kas_realloc(st->log, st->log_cap * sizeof(struct alias_record),
+				  cap * sizeof(struct alias_record));
+		if (!log)
+			return 0;
+		st->log = log;
+		st->log_cap = cap;
+	}
+
+	st->log[st->log_len].name = name;
+	st->log[st->log_len].name_len = len;
+	st->log_len++;
+	return 1;
+}
+
+/* True if this run saw the recorded symbol set and every group as recorded. */
+bool alias_state_matches(struct alias_state *st)
+{
+	size_t i;
+
+	if (!st->loaded || st->diverged || st->seen_symbols != st->symbols ||
+	    st->seen_checksum != st->checksum)
+		return false;
+
+	for (i = 0; i < st->ngroups; i++)
+		if (st->groups[i].used != st->groups[i].count)
+			return false;
+
+	return true;
+}
+
+/* Count the aliases logged by this run per name and write them out. */
+int alias_state_save(struct alias_state *st, const char *path)
+{
+	struct dup_entry *entry;
+	struct alias_record *r;
+	struct dup_table table;
+	char *tmp_path;
+	int ret = 0;
+	FILE *fp;
+	size_t i;
+
+	tmp_path = kas_malloc(strlen(path) + 5);
+	if (!tmp_path || !dup_table_init(&table, st->log_len)) {
+		kas_free(tmp_path);
+		return 0;
+	}
+
+	for (i = 0; i < st->log_len; i++) {
+		r = &st->log[i];
+		entry = dup_table_insert(&table, r->name, r->name_len,
+					 name_hash(r->name, r->name_len));
+		if (!entry)
+			goto out;
+		entry->count++;
+	}
+
+	sprintf(tmp_path, "%s.tmp", path);
+	fp = fopen(tmp_path, "w");
+	if (!fp)
+		goto out;
+
+	fprintf(fp, "%s %d %" PRIu64 " %" PRIx64 " %zu\n", ALIAS_STATE_MAGIC,
+		ALIAS_STATE_VERSION, st->seen_symbols, st->seen_checksum, table.used);
+	for (i = 0; i <= table.mask; i++) {
+		entry = &table.slots[i];
+		if (entry->name)
+			fprintf(fp, "%.*s %u\n", (int)entry->name_len, entry->name, entry->count);
+	}
+
+	ret = !ferror(fp);
+	ret &= fclose(fp) == 0;
+	if (ret)
+		ret = rename(tmp_path, path) == 0;
+	else
+		unlink(tmp_path);
+out:
+	kas_free(tmp_path);
+	dup_table_free(&table);
+	return ret;
+}
+
+void alias_state_free(struct alias_state *st)
+{
+	if (st->names.slots)
+		dup_table_free(&st->names);
+	kas_free(st->groups);
+	kas_free(st->data);
+	kas_free(st->log);
+	st->loaded = false;
+}
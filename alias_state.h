@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef ALIAS_STATE_H
+#define ALIAS_STATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "duplicates_list.h"
+
+#define ALIAS_STATE_MAGIC "kas_alias-state"
+#define ALIAS_STATE_VERSION 3
+
+/*
+ * Duplicate groups carried from one kallsyms link pass to the next. The
+ * symbol set does not change between passes, only the addresses do, so a
+ * later pass can mark duplicates straight from the file. The aliases
+ * themselves are per-name ordinals and need no recording.
+ */
+struct alias_group {
+	const char	*name;		/* NUL terminated, inside alias_state.data */
+	uint32_t	count;
+	uint32_t	used;
+};
+
+struct alias_record {
+	const char	*name;
+	uint32_t	name_len;
+};
+
+struct alias_state {
+	struct dup_table	names;		/* entry->first is the group index */
+	struct alias_group	*groups;
+	size_t			ngroups;
+	char			*data;
+	uint64_t		symbols;
+	uint64_t		checksum;
+	bool			loaded;
+	/* this run */
+	uint64_t		seen_symbols;
+	uint64_t		seen_checksum;
+	bool			diverged;
+	struct alias_record	*log;
+	size_t			log_len;
+	size_t			log_cap;
+};
+
+int alias_state_load(struct alias_state *st, const char *path);
+struct alias_group *alias_state_group(struct alias_state *st, const char *name, size_t len,
+				      uint32_t hash);
+uint32_t alias_state_ordinal(struct alias_state *st, struct alias_group *group);
+int alias_state_log(struct alias_state *st, const char *name, size_t len);
+bool alias_state_matches(struct alias_state *st);
+int alias_state_save(struct alias_state *st, const char *path);
+void alias_state_free(struct alias_state *st);
+
+/*
+ * Fingerprint of the symbol names seen in this run, in address order: a
+ * 64-bit FNV-1a of each name chained through the sequence, so that a
+ * different name or the same names in another order give another value.
+ * Addresses are left out, as they move between link passes.
+ */
+static inline void alias_state_count(struct alias_state *st, const char *name, size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (unsigned char)name[i]) * 0x100000001b3ULL;
+	st->seen_symbols++;
+	st->seen_checksum = (st->seen_checksum ^ h) * 0x9e3779b97f4a7c15ULL + 1;
+}
+#endif
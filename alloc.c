@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "alloc.h"
+#include "stats.h"
+
+static void *libc_alloc(void *ctx, size_t size)
+{
+	(void)ctx;
+	return malloc(size);
+}
+
+static void *libc_calloc(void *ctx, size_t n, size_t size)
+{
+	(void)ctx;
+	return calloc(n, size);
+}
+
+static void *libc_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	(void)ctx;
+	(void)old_size;
+	return realloc(ptr, size);
+}
+
+static void libc_free(void *ctx, void *ptr)
+{
+	(void)ctx;
+	free(ptr);
+}
+
+static const struct kas_allocator libc_allocator = {
+	.alloc		= libc_alloc,
+	.calloc		= libc_calloc,
+	.realloc	= libc_realloc,
+	.free		= libc_free,
+};
+
+static const struct kas_allocator *allocator = &libc_allocator;
+
+/* Not thread safe: install before any allocation is made. */
+void kas_set_allocator(const struct kas_allocator *a)
+{
+	allocator = a ? a : &libc_allocator;
+}
+
+const struct kas_allocator *kas_get_allocator(void)
+{
+	return allocator;
+}
+
+void *kas_malloc(size_t size)
+{
+	void *p = allocator->alloc(allocator->ctx, size);
+
+	if (p)
+		stats_alloc(size);
+	return p;
+}
+
+void *kas_calloc(size_t n, size_t size)
+{
+	void *p = allocator->calloc(allocator->ctx, n, size);
+
+	if (p)
+		stats_alloc(n * size);
+	return p;
+}
+
+/* old_size is what ptr was last allocated with, 0 for NULL. */
+void *kas_realloc(void *ptr, size_t old_size, size_t size)
+{
+	void *p = allocator->realloc(allocator->ctx, ptr, old_size, size);
+
+	if (p)
+		stats_alloc(size > old_size ? size - old_size : 0);
+	return p;
+}
+
+void kas_free(void *ptr)
+{
+	if (ptr)
+		allocator->free(allocator->ctx, ptr);
+}
+
+/* -j workers allocate concurrently, so the count is atomic. */
+static bool fault_hit(struct fault_allocator *f)
+{
+	if (__atomic_add_fetch(&f->count, 1, __ATOMIC_RELAXED) != f->fail_at)
+		return false;
+	errno = ENOMEM;
+	return true;
+}
+
+static void *fault_alloc(void *ctx, size_t size)
+{
+	struct fault_allocator *f = ctx;
+
+	return fault_hit(f) ? NULL : f->next->alloc(f->next->ctx, size);
+}
+
+static void *fault_calloc(void *ctx, size_t n, size_t size)
+{
+	struct fault_allocator *f = ctx;
+
+	return fault_hit(f) ? NULL : f->next->calloc(f->next->ctx, n, size);
+}
+
+static void *fault_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	struct fault_allocator *f = ctx;
+
+	return fault_hit(f) ? NULL : f->next->realloc(f->next->ctx, ptr, old_size, size);
+}
+
+static void fault_free(void *ctx, void *ptr)
+{
+	struct fault_allocator *f = ctx;
+
+	f->next->free(f->next->ctx, ptr);
+}
+
+/* Wraps whatever allocator is current when called. */
+void fault_allocator_init(struct fault_allocator *f, unsigned long fail_at)
+{
+	f->ops.alloc = fault_alloc;
+	f->ops.calloc = fault_calloc;
+	f->ops.realloc = fault_realloc;
+	f->ops.free = fault_free;
+	f->ops.ctx = f;
+	f->next = allocator;
+	f->fail_at = fail_at;
+	f->count = 0;
+}
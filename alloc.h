@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Every allocation kas_alias makes goes through one of these. Small
+ * objects (symbol names) come out of struct arena chunks, so the calls
+ * here are few and large and the indirection costs nothing measurable.
+ */
+struct kas_allocator {
+	void	*(*alloc)(void *ctx, size_t size);
+	void	*(*calloc)(void *ctx, size_t n, size_t size);
+	void	*(*realloc)(void *ctx, void *ptr, size_t old_size, size_t size);
+	void	(*free)(void *ctx, void *ptr);
+	void	*ctx;
+};
+
+/* Fails the fail_at-th allocation (counting from 1) and no other. */
+struct fault_allocator {
+	struct kas_allocator		ops;
+	const struct kas_allocator	*next;
+	unsigned long			fail_at;
+	unsigned long			count;
+};
+
+void kas_set_allocator(const struct kas_allocator *allocator);
+const struct kas_allocator *kas_get_allocator(void);
+void fault_allocator_init(struct fault_allocator *f, unsigned long fail_at);
+
+void *kas_malloc(size_t size);
+void *kas_calloc(size_t n, size_t size);
+void *kas_realloc(void *ptr, size_t old_size, size_t size);
+void kas_free(void *ptr);
+#endif
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "alloc.h"
+
+static inline size_t align_offset(const struct arena_chunk *chunk, size_t align)
+{
+	uintptr_t p = (uintptr_t)(chunk->data + chunk->used);
+
+	return chunk->used + ((-p) & (align - 1));
+}
+
+static struct arena_chunk *new_chunk(size_t min_size)
+{
+	size_t size = min_size > ARENA_CHUNK_SIZE ? min_size : ARENA_CHUNK_SIZE;
+	struct arena_chunk *chunk = kas_malloc(sizeof(struct arena_chunk) + size);
+
+	if (!chunk)
+		return NULL;
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+void *arena_alloc(struct arena *a, size_t size, size_t align)
+{
+	struct arena_chunk *chunk = a->head;
+	size_t offset;
+
+	if (chunk) {
+		offset = align_offset(chunk, align);
+		if (offset + size <= chunk->size) {
+			chunk->used = offset + size;
+			return chunk->data + offset;
+		}
+	}
+
+	chunk = new_chunk(size + align);
+	if (!chunk)
+		return NULL;
+
+	chunk->next = a->head;
+	a->head = chunk;
+	offset = align_offset(chunk, align);
+	chunk->used = offset + size;
+	return chunk->data + offset;
+}
+
+char *arena_strndup(struct arena *a, const char *s, size_t len)
+{
+	char *p = arena_alloc(a, len + 1, 1);
+
+	if (!p)
+		return NULL;
+
+	memcpy(p, s, len);
+	p[len] = '\0';
+	return p;
+}
+
+void arena_release(struct arena *a)
+{
+	struct arena_chunk *app, *chunk_iterator = a->head;
+
+	while (chunk_iterator) {
+		app = chunk_iterator;
+		chunk_iterator = chunk_iterator->next;
+		kas_free(app);
+	}
+	a->head = NULL;
+}
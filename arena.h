@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Chunks are large enough that a full vmlinux symbol table only needs a
+ * few dozen of them; allocations never move once handed out.
+ */
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+struct arena_chunk {
+	struct arena_chunk	*next;
+	size_t			size;
+	size_t			used;
+	char			data[];
+};
+
+struct arena {
+	struct arena_chunk	*head;
+};
+
+void *arena_alloc(struct arena *a, size_t size, size_t align);
+char *arena_strndup(struct arena *a, const char *s, size_t len);
+void arena_release(struct arena *a);
+#endif
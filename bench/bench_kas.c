@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Runs the phases of kas_alias on one nm file, times each of them and
+ * reports the best of several runs with throughput and peak RSS.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "../item_list.h"
+#include "../duplicates_list.h"
+#include "../nm_parser.h"
+#include "../output.h"
+#include "../parallel.h"
+#include "../linker_map.h"
+
+enum phase {
+	PH_PARSE,
+	PH_HASH_DEDUP,
+	PH_OUTPUT,
+	PH_NAME_SORT,
+	PH_FIND_DUPLICATES,
+	PH_ADDR_SORT,
+	PH_FUSED,
+	PH_LINKER_MAP,
+	PH_MAP_LOOKUP,
+	PH_COUNT
+};
+
+static const char *const phase_names[PH_COUNT] = {
+	[PH_PARSE]		= "parse",
+	[PH_HASH_DEDUP]		= "hash dedup",
+	[PH_OUTPUT]		= "output",
+	[PH_NAME_SORT]		= "name sort",
+	[PH_FIND_DUPLICATES]	= "find_duplicates",
+	[PH_ADDR_SORT]		= "address sort",
+	[PH_FUSED]		= "parse+dedup",
+	[PH_LINKER_MAP]		= "linker map",
+	[PH_MAP_LOOKUP]		= "map lookup",
+};
+
+static double best[PH_COUNT];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void record(enum phase ph, double start)
+{
+	double t = now() - start;
+
+	if (!best[ph] || t < best[ph])
+		best[ph] = t;
+}
+
+static void fail(const char *what)
+{
+	fprintf(stderr, "bench: %s failed\n", what);
+	exit(1);
+}
+
+static int parse(struct nm_parser *parser, struct item_list *list, int jobs)
+{
+	struct nm_record rec;
+	bool sorted = true;
+
+	if (jobs > 1)
+		return parallel_parse(list, parser, jobs, &sorted);
+
+	while (nm_next_record(parser, &rec) > 0)
+		if (!add_item_ref(list, rec.name, rec.name_len, rec.stype, rec.addr))
+			return 0;
+	return 1;
+}
+
+/* The single thread engine of kas_alias: nm -n input numbered in batches as it is parsed. */
+static int parse_numbered(struct nm_parser *parser, struct item_list *list)
+{
+	struct dup_table dups;
+	struct nm_record rec;
+	size_t done = 0;
+	int ret = 1;
+
+	if (!dup_table_init(&dups, parser->len / 40))
+		return 0;
+	while (ret && nm_next_record(parser, &rec) > 0) {
+		if (!add_item_ref(list, rec.name, rec.name_len, rec.stype, rec.addr))
+			ret = 0;
+		else if (list->count - done == DUP_NUMBER_BATCH)
+			ret = dup_table_number(&dups, list, &done);
+	}
+	if (ret)
+		ret = dup_table_number(&dups, list, &done);
+	dup_table_free(&dups);
+	return ret;
+}
+
+/* Loads the map and finds the object of every symbol of an address sorted list. */
+static size_t run_map(const char *path, const struct item_list *list)
+{
+	struct map_cursor cursor;
+	struct linker_map map;
+	size_t i, found = 0;
+	double start;
+
+	start = now();
+	if (linker_map_load(&map, path) <= 0)
+		fail("linker map");
+	record(PH_LINKER_MAP, start);
+
+	start = now();
+	map_cursor_init(&cursor, &map);
+	for (i = 0; i < list->count; i++)
+		found += map_cursor_find(&cursor, list->items[i].addr) != NULL;
+	record(PH_MAP_LOOKUP, start);
+
+	linker_map_free(&map);
+	return found;
+}
+
+static void run(const char *path, int jobs, int null_fd, const char *map, size_t *found)
+{
+	struct item_list list = {0};
+	struct nm_parser parser;
+	struct output out;
+	double start;
+	size_t i;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || !nm_parser_init(&parser, fd) || !parser.mapped)
+		fail("mapping the input");
+
+	start = now();
+	if (!parse(&parser, &list, jobs))
+		fail("parse");
+	record(PH_PARSE, start);
+
+	/* nm -n input, as the kernel build feeds it */
+	start = now();
+	if (!(jobs > 1 ? parallel_find_duplicates(&list, jobs) : find_duplicates_hash(&list)))
+		fail("hash dedup");
+	record(PH_HASH_DEDUP, start);
+
+	if (!out_init(&out, null_fd))
+		fail("output");
+	start = now();
+	if (jobs > 1) {
+		if (!parallel_write(&out, &list, jobs))
+			fail("output");
+	} else {
+		for (i = 0; i < list.count; i++)
+			out_item(&out, &list.items[i]);
+	}
+	out_flush(&out);
+	record(PH_OUTPUT, start);
+	out_free(&out);
+
+	/* unordered input goes through the sorts instead */
+	for (i = 0; i < list.count; i++)
+		list.items[i].alias = 0;
+
+	start = now();
+	if (!sort_list_m(&list, BY_NAME))
+		fail("name sort");
+	record(PH_NAME_SORT, start);
+
+	start = now();
+	find_duplicates(&list);
+	record(PH_FIND_DUPLICATES, start);
+
+	start = now();
+	if (!sort_list_m(&list, BY_ADDRESS))
+		fail("address sort");
+	record(PH_ADDR_SORT, start);
+
+	if (map)
+		*found = run_map(map, &list);
+
+	free_items(&list);
+
+	if (jobs == 1) {
+		parser.pos = 0;
+		start = now();
+		if (!parse_numbered(&parser, &list))
+			fail("parse+dedup");
+		record(PH_FUSED, start);
+		free_items(&list);
+	}
+	nm_parser_free(&parser);
+	close(fd);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s <nmfile> [-r <runs>] [-j <jobs>] [-m <linker map>]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct item_list list = {0};
+	struct nm_parser parser;
+	struct rusage ru;
+	double mb, total = 0;
+	int i, runs = 5, jobs = 1;
+	const char *map = NULL;
+	size_t symbols, found = 0;
+	int fd, null_fd;
+
+	if (argc < 2) {
+		usage(argv[0]);
+		return 1;
+	}
+	for (i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			map = argv[++i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (runs < 1 || jobs < 1 || jobs > MAX_JOBS) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0 || !nm_parser_init(&parser, fd) || !parse(&parser, &list, 1))
+		fail("reading the input");
+	mb = parser.len / 1e6;
+	symbols = list.count;
+	free_items(&list);
+	nm_parser_free(&parser);
+	close(fd);
+
+	null_fd = open("/dev/null", O_WRONLY);
+	if (null_fd < 0)
+		fail("opening /dev/null");
+
+	for (i = 0; i < runs; i++)
+		run(argv[1], jobs, null_fd, map, &found);
+
+	printf("%s: %zu symbols, %.1f MB, %d job%s, best of %d\n",
+	       argv[1], symbols, mb, jobs, jobs > 1 ? "s" : "", runs);
+	printf("%-16s %10s %10s %12s\n", "phase", "ms", "MB/s", "Msym/s");
+	for (i = 0; i < PH_FUSED; i++) {
+		printf("%-16s %10.2f %10.1f %12.2f\n", phase_names[i], best[i] * 1e3,
+		       mb / best[i], symbols / best[i] / 1e6);
+		if (i <= PH_OUTPUT)
+			total += best[i];
+	}
+	printf("%-16s %10.2f %10.1f %12.2f\n", "nm -n total", total * 1e3, mb / total,
+	       symbols / total / 1e6);
+	if (jobs == 1) {
+		/* what kas_alias runs on nm -n input with one thread */
+		total = best[PH_FUSED] + best[PH_OUTPUT];
+		printf("%-16s %10.2f %10.1f %12.2f\n", phase_names[PH_FUSED],
+		       best[PH_FUSED] * 1e3, mb / best[PH_FUSED], symbols / best[PH_FUSED] / 1e6);
+		printf("%-16s %10.2f %10.1f %12.2f\n", "fused total", total * 1e3, mb / total,
+		       symbols / total / 1e6);
+	}
+	if (map) {
+		printf("%-16s %10.2f\n", phase_names[PH_LINKER_MAP], best[PH_LINKER_MAP] * 1e3);
+		printf("%-16s %10.2f %10s %12.2f  %zu of the symbols found\n",
+		       phase_names[PH_MAP_LOOKUP], best[PH_MAP_LOOKUP] * 1e3, "",
+		       symbols / best[PH_MAP_LOOKUP] / 1e6, found);
+	}
+
+	getrusage(RUSAGE_SELF, &ru);
+	printf("peak RSS %ld KB, %.0f bytes per symbol\n", ru.ru_maxrss,
+	       ru.ru_maxrss * 1024.0 / (symbols ? symbols : 1));
+	return 0;
+}
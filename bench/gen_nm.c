@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Writes a synthetic `nm -n vmlinux` listing, shaped after real kernels:
+ * every function comes with a __pfx_ padding symbol 16 bytes before it,
+ * and a share of the names belong to static functions and variables
+ * defined in several objects, scattered over the whole image.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+static const char *const words[] = {
+	"device", "show", "store", "init", "exit", "probe", "remove", "read",
+	"write", "open", "release", "ioctl", "mmap", "poll", "get", "set",
+	"put", "alloc", "free", "enable", "disable", "reset", "suspend",
+	"resume", "irq", "handler", "work", "timer", "queue", "lock", "stat",
+	"attr", "ops", "notifier", "cb", "state", "map", "unmap",
+};
+
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+static uint64_t rnd(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static unsigned int rnd_below(unsigned int n)
+{
+	return rnd() % n;
+}
+
+static void make_name(char *buf, size_t size, unsigned long id, int words_min, int words_max)
+{
+	int i, n = words_min + rnd_below(words_max - words_min + 1);
+	size_t len = 0;
+
+	for (i = 0; i < n; i++)
+		len += snprintf(buf + len, size - len, "%s%s", i ? "_" : "", words[rnd_below(NWORDS)]);
+	if (id)
+		snprintf(buf + len, size - len, "_%lu", id);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-n <symbols>] [-d <dup percent>] [-s <seed>]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char data_types[] = "dDbBrR";
+	static const char text_types[] = "tT";
+	unsigned long symbols = 250000, dup_percent = 5, seed = 1;
+	uint64_t addr = 0xffffffff81000000ULL;
+	char **dup_names, name[128];
+	unsigned long i, ndups;
+	bool shared;
+	int opt;
+	char t;
+
+	while ((opt = getopt(argc, argv, "n:d:s:")) != -1) {
+		switch (opt) {
+		case 'n':
+			symbols = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			dup_percent = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (dup_percent > 100) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	rng_state ^= seed * 0x9e3779b97f4a7c15ULL;
+
+	/* a shared name shows up five times on average */
+	ndups = symbols * dup_percent / 500 + 1;
+	dup_names = malloc(ndups * sizeof(char *));
+	if (!dup_names)
+		return 1;
+	for (i = 0; i < ndups; i++) {
+		make_name(name, sizeof(name), 0, 1, 3);
+		dup_names[i] = strdup(name);
+		if (!dup_names[i])
+			return 1;
+	}
+
+	for (i = 0; i < symbols; i++) {
+		shared = rnd_below(100) < dup_percent;
+		if (shared)
+			strcpy(name, dup_names[rnd_below(ndups)]);
+		else
+			make_name(name, sizeof(name), i, 2, 4);
+
+		/* three quarters functions; shared names are always local */
+		t = rnd_below(4) ? text_types[rnd_below(2)] : data_types[rnd_below(6)];
+		if (shared)
+			t |= 0x20;
+
+		if (t == 't' || t == 'T') {
+			printf("%016llx %c __pfx_%s\n", (unsigned long long)addr, t, name);
+			addr += 16;
+		}
+		printf("%016llx %c %s\n", (unsigned long long)addr, t, name);
+		addr += 16 * rnd_below(12);
+	}
+
+	return fflush(stdout) != 0 || ferror(stdout);
+}
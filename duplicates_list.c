@@ -7,87 +7,205 @@
 
 #include "item_list.h"
 #include "duplicates_list.h"
+#include "alloc.h"
 
-#ifdef DEBUG
-int duplicates_alloc_cnt;
-
-static inline void inc_duplicates_cnt(void)
+/* Runs are short, so a plain insertion sort puts them in address order. */
+static void order_run(struct item *items, size_t count)
 {
-	duplicates_alloc_cnt++;
+	struct item tmp;
+	size_t i, j;
+
+	for (i = 1; i < count; i++) {
+		tmp = items[i];
+		for (j = i; j > 0 && items[j - 1].addr > tmp.addr; j--)
+			items[j] = items[j - 1];
+		items[j] = tmp;
+	}
 }
 
-static inline void dec_duplicates_cnt(void)
+/*
+ * The list must be sorted by name: every item belonging to a run of
+ * equal names is numbered by address, the run being put in address
+ * order.
+ */
+void find_duplicates(struct item_list *list)
 {
-	duplicates_alloc_cnt--;
+	size_t i, run, first;
+
+	for (first = 0; first < list->count; first = run) {
+		for (run = first + 1; run < list->count &&
+		     same_name(&list->items[run], &list->items[first]); run++)
+			;
+		if (run - first < 2)
+			continue;
+
+		order_run(&list->items[first], run - first);
+		for (i = first; i < run; i++)
+			list->items[i].alias = i - first + 1;
+	}
 }
 
-#else
+static int dup_table_alloc(struct dup_table *t, size_t size)
+{
+	t->slots = kas_calloc(size, sizeof(struct dup_entry));
+	if (!t->slots)
+		return 0;
 
-static inline void inc_duplicates_cnt(void) {};
-static inline void dec_duplicates_cnt(void) {};
+	t->mask = size - 1;
+	t->used = 0;
+	return 1;
+}
 
-#endif
+int dup_table_init(struct dup_table *t, size_t expected)
+{
+	size_t size;
 
+	for (size = 64; size < 2 * expected; size *= 2)
+		;
+	return dup_table_alloc(t, size);
+}
 
-struct duplicate_item *find_duplicates(struct item *list)
+static struct dup_entry *probe(struct dup_table *t, const char *name, size_t len,
+			       uint32_t hash)
 {
-	struct duplicate_item *current_duplicate = NULL;
-	struct duplicate_item *duplicates = NULL;
-	struct duplicate_item *new_duplicate;
-	struct item *current_item = list;
-	bool prev_was_duplicate = false;
-	struct item *prev_item = NULL;
-
-	while (current_item) {
-		if ((prev_item && (strcmp(current_item->symb_name, prev_item->symb_name) == 0)) ||
-		    prev_was_duplicate) {
-			if (!duplicates) {
-				inc_duplicates_cnt();
-				duplicates = malloc(sizeof(struct duplicate_item));
-				if (!duplicates)
-					return NULL;
-				duplicates->original_item = prev_item;
-				duplicates->next = NULL;
-				current_duplicate = duplicates;
-			} else {
-				inc_duplicates_cnt();
-				new_duplicate = malloc(sizeof(struct duplicate_item));
-				if (!new_duplicate) {
-					free_duplicates(&duplicates);
-					return NULL;
-				}
-
-				new_duplicate->original_item = prev_item;
-				new_duplicate->next = NULL;
-				current_duplicate->next = new_duplicate;
-				current_duplicate = new_duplicate;
-
-				if ((strcmp(current_item->symb_name, prev_item->symb_name) != 0) &&
-				    (prev_was_duplicate))
-					prev_was_duplicate = false;
-				else
-					prev_was_duplicate = true;
-			}
+	struct dup_entry *entry;
+	size_t i;
+
+	for (i = hash & t->mask; ; i = (i + 1) & t->mask) {
+		entry = &t->slots[i];
+		if (!entry->name)
+			return entry;
+		if (entry->hash == hash && entry->name_len == len &&
+		    memcmp(entry->name, name, len) == 0)
+			return entry;
+	}
+}
+
+static int dup_table_grow(struct dup_table *t)
+{
+	struct dup_entry *old = t->slots;
+	size_t i, size = t->mask + 1;
+
+	if (!dup_table_alloc(t, size * 2)) {
+		t->slots = old;
+		t->mask = size - 1;
+		return 0;
+	}
+
+	for (i = 0; i < size; i++) {
+		if (old[i].name) {
+			*probe(t, old[i].name, old[i].name_len, old[i].hash) = old[i];
+			t->used++;
 		}
+	}
+	kas_free(old);
+	return 1;
+}
+
+/*
+ * Returns the entry for name, claiming an empty one (count == 0) if the
+ * name is new. The table doubles at half load, so the returned pointer
+ * is only valid until the next insertion unless the table was sized for
+ * every name up front.
+ */
+struct dup_entry *dup_table_insert(struct dup_table *t, const char *name, size_t len,
+				   uint32_t hash)
+{
+	struct dup_entry *entry;
+
+	if (2 * (t->used + 1) > t->mask + 1 && !dup_table_grow(t))
+		return NULL;
 
-		prev_item = current_item;
-		current_item = current_item->next;
+	entry = probe(t, name, len, hash);
+	if (!entry->name) {
+		entry->name = name;
+		entry->name_len = len;
+		entry->hash = hash;
+		t->used++;
 	}
+	return entry;
+}
+
+/* Lookup only; NULL if the name is not in the table. */
+struct dup_entry *dup_table_find(struct dup_table *t, const char *name, size_t len,
+				 uint32_t hash)
+{
+	struct dup_entry *entry = probe(t, name, len, hash);
+
+	return entry->name ? entry : NULL;
+}
+
+void dup_table_free(struct dup_table *t)
+{
+	kas_free(t->slots);
+	t->slots = NULL;
+}
+
+/*
+ * Numbers item i after the items of its name seen before it. The first
+ * item of a name is only given its 1 once a second one shows up, so a
+ * name that occurs once keeps alias 0 and no second walk is needed.
+ */
+static int number_item(struct dup_table *t, struct item_list *list, size_t i)
+{
+	struct item *item = &list->items[i];
+	struct dup_entry *entry;
+
+	entry = dup_table_insert(t, item->symb_name, item->name_len, item->hash);
+	if (!entry)
+		return 0;
 
-	return duplicates;
+	if (!entry->count++) {
+		entry->first = i;
+		item->alias = 0;
+		return 1;
+	}
+	if (entry->count == 2)
+		list->items[entry->first].alias = 1;
+	item->alias = entry->count;
+	return 1;
 }
 
-void free_duplicates(struct duplicate_item **duplicates)
+#define PREFETCH_AHEAD 8
+
+/*
+ * Numbers the items added to list since *done and moves *done to the
+ * end, so a list can be numbered in batches while it is being parsed.
+ * The slots of the items a few ahead are prefetched: most names are
+ * new, and each is a cache miss into the table.
+ */
+int dup_table_number(struct dup_table *t, struct item_list *list, size_t *done)
 {
-	struct duplicate_item *duplicates_iterator = *duplicates;
-	struct duplicate_item *app;
-
-	while (duplicates_iterator) {
-		app = duplicates_iterator;
-		duplicates_iterator = duplicates_iterator->next;
-		free(app);
-		dec_duplicates_cnt();
+	size_t i;
+
+	for (i = *done; i < list->count && i < *done + PREFETCH_AHEAD; i++)
+		__builtin_prefetch(&t->slots[list->items[i].hash & t->mask]);
+
+	for (i = *done; i < list->count; i++) {
+		if (i + PREFETCH_AHEAD < list->count)
+			__builtin_prefetch(&t->slots[list->items[i + PREFETCH_AHEAD].hash & t->mask]);
+		if (!number_item(t, list, i)) {
+			*done = i;
+			return 0;
+		}
 	}
+	*done = i;
+	return 1;
+}
 
-	*duplicates = NULL;
+/* Single pass over the list with an open addressing table keyed by name. */
+int find_duplicates_hash(struct item_list *list)
+{
+	struct dup_table table;
+	size_t done = 0;
+	int ret;
+
+	if (!list->count)
+		return 1;
+	if (!dup_table_init(&table, list->count))
+		return 0;
+
+	ret = dup_table_number(&table, list, &done);
+	dup_table_free(&table);
+	return ret;
 }
@@ -5,12 +5,33 @@
 #include "debug.h"
 #include "item_list.h"
 
-struct duplicate_item {
-	struct item *original_item;
-	struct duplicate_item *next;
+/* An empty slot has a NULL name. */
+struct dup_entry {
+	const char	*name;
+	uint32_t	name_len;
+	uint32_t	hash;
+	uint32_t	count;
+	uint32_t	first;
 };
 
-struct duplicate_item *find_duplicates(struct item *list);
-void free_duplicates(struct duplicate_item **duplicates);
+struct dup_table {
+	struct dup_entry	*slots;
+	size_t			mask;
+	size_t			used;
+};
+
+int dup_table_init(struct dup_table *t, size_t expected);
+struct dup_entry *dup_table_insert(struct dup_table *t, const char *name, size_t len,
+				   uint32_t hash);
+struct dup_entry *dup_table_find(struct dup_table *t, const char *name, size_t len,
+				 uint32_t hash);
+/* items a parser adds before numbering them, while they are still in cache */
+#define DUP_NUMBER_BATCH 256
+
+int dup_table_number(struct dup_table *t, struct item_list *list, size_t *done);
+void dup_table_free(struct dup_table *t);
+
+void find_duplicates(struct item_list *list);
+int find_duplicates_hash(struct item_list *list);
 
 #endif
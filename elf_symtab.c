@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <elf.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "elf_symtab.h"
+
+/* Fields are read with memcpy: the mapped image need not be aligned for the host. */
+static uint16_t rd16(const struct elf_symtab *e, const char *p)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return e->swap ? bswap_16(v) : v;
+}
+
+static uint32_t rd32(const struct elf_symtab *e, const char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return e->swap ? bswap_32(v) : v;
+}
+
+static uint64_t rd64(const struct elf_symtab *e, const char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return e->swap ? bswap_64(v) : v;
+}
+
+/* An address or size sized field of the image's class. */
+#define RD_WORD(e, p, type, field) ((e)->is64 ? \
+	rd64(e, (p) + offsetof(Elf64_##type, field)) : \
+	rd32(e, (p) + offsetof(Elf32_##type, field)))
+
+#define RD_FIELD(e, p, type, field, bits) ((e)->is64 ? \
+	rd##bits(e, (p) + offsetof(Elf64_##type, field)) : \
+	rd##bits(e, (p) + offsetof(Elf32_##type, field)))
+
+struct section {
+	uint32_t	name;
+	uint32_t	type;
+	uint64_t	flags;
+	uint64_t	offset;
+	uint64_t	size;
+	uint32_t	link;
+};
+
+static void read_section(const struct elf_symtab *e, size_t index, struct section *s)
+{
+	const char *sh = e->shdrs + index * (e->is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr));
+
+	s->name = RD_FIELD(e, sh, Shdr, sh_name, 32);
+	s->type = RD_FIELD(e, sh, Shdr, sh_type, 32);
+	s->flags = RD_WORD(e, sh, Shdr, sh_flags);
+	s->offset = RD_WORD(e, sh, Shdr, sh_offset);
+	s->size = RD_WORD(e, sh, Shdr, sh_size);
+	s->link = RD_FIELD(e, sh, Shdr, sh_link, 32);
+}
+
+/* Start of a section's contents, NULL if they lie outside the image. */
+static const char *section_data(const struct elf_symtab *e, const struct section *s)
+{
+	if (s->type == SHT_NOBITS || s->offset > e->len || s->size > e->len - s->offset)
+		return NULL;
+	return e->buf + s->offset;
+}
+
+bool is_elf(const char *buf, size_t len)
+{
+	return len >= EI_NIDENT && memcmp(buf, ELFMAG, SELFMAG) == 0;
+}
+
+/*
+ * Locates the symbol and string tables. Returns 1 on success and 0 if
+ * the image is truncated, of an unknown class or byte order, or stripped.
+ */
+int elf_symtab_init(struct elf_symtab *e, const char *buf, size_t len)
+{
+	struct section s, strtab;
+	uint64_t shoff;
+	size_t i, shsize, shstrndx, xindex_len = 0;
+
+	memset(e, 0, sizeof(*e));
+	e->buf = buf;
+	e->len = len;
+
+	if (!is_elf(buf, len))
+		return 0;
+	if (buf[EI_CLASS] != ELFCLASS32 && buf[EI_CLASS] != ELFCLASS64)
+		return 0;
+	if (buf[EI_DATA] != ELFDATA2LSB && buf[EI_DATA] != ELFDATA2MSB)
+		return 0;
+
+	e->is64 = buf[EI_CLASS] == ELFCLASS64;
+	e->swap = (buf[EI_DATA] == ELFDATA2LSB) != (__BYTE_ORDER == __LITTLE_ENDIAN);
+	if (len < (e->is64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr)))
+		return 0;
+
+	shoff = RD_WORD(e, buf, Ehdr, e_shoff);
+	shsize = e->is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+	if (!shoff || shoff > len || len - shoff < shsize)
+		return 0;
+	e->shdrs = buf + shoff;
+
+	/* more than SHN_LORESERVE sections: the counts move to section 0 */
+	e->shnum = RD_FIELD(e, buf, Ehdr, e_shnum, 16);
+	shstrndx = RD_FIELD(e, buf, Ehdr, e_shstrndx, 16);
+	read_section(e, 0, &s);
+	if (!e->shnum)
+		e->shnum = s.size;
+	if (shstrndx == SHN_XINDEX)
+		shstrndx = s.link;
+	if (e->shnum > (len - shoff) / shsize)
+		return 0;
+
+	if (shstrndx && shstrndx < e->shnum) {
+		read_section(e, shstrndx, &s);
+		e->shstrtab = section_data(e, &s);
+		e->shstrtab_len = s.size;
+	}
+
+	for (i = 1; i < e->shnum; i++) {
+		read_section(e, i, &s);
+		if (s.type == SHT_SYMTAB && !e->syms) {
+			e->syms = section_data(e, &s);
+			e->sym_size = e->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+			e->nsyms = s.size / e->sym_size;
+			if (!e->syms || s.link >= e->shnum)
+				return 0;
+			read_section(e, s.link, &strtab);
+			e->strtab = section_data(e, &strtab);
+			e->strtab_len = strtab.size;
+			if (!e->strtab)
+				return 0;
+		} else if (s.type == SHT_SYMTAB_SHNDX) {
+			e->xindex = section_data(e, &s);
+			xindex_len = s.size / sizeof(uint32_t);
+		}
+	}
+	if (xindex_len < e->nsyms)
+		e->xindex = NULL;
+
+	/* the null symbol is never listed */
+	e->pos = 1;
+	return e->syms != NULL;
+}
+
+static bool is_debug_section(const struct elf_symtab *e, const struct section *s)
+{
+	static const char prefix[] = ".debug";
+
+	return e->shstrtab && s->name < e->shstrtab_len &&
+	       e->shstrtab_len - s->name >= sizeof(prefix) - 1 &&
+	       memcmp(e->shstrtab + s->name, prefix, sizeof(prefix) - 1) == 0;
+}
+
+/*
+ * The letter nm prints for a defined symbol, 0 for symbols it does not
+ * list: undefined ones, which carry no address, and section and file
+ * symbols.
+ */
+static char symbol_type(const struct elf_symtab *e, unsigned char info, size_t shndx)
+{
+	unsigned char bind = ELF64_ST_BIND(info), type = ELF64_ST_TYPE(info);
+	struct section s;
+	char c;
+
+	if (shndx == SHN_UNDEF || type == STT_SECTION || type == STT_FILE)
+		return 0;
+	if (shndx == SHN_COMMON)
+		return 'C';
+	if (bind == STB_WEAK)
+		return type == STT_OBJECT ? 'V' : 'W';
+	if (bind == STB_GNU_UNIQUE)
+		return 'u';
+	if (type == STT_GNU_IFUNC)
+		return 'i';
+
+	if (shndx == SHN_ABS) {
+		c = 'a';
+	} else if (shndx >= e->shnum) {
+		c = '?';
+	} else {
+		read_section(e, shndx, &s);
+		if (s.flags & SHF_EXECINSTR)
+			c = 't';
+		else if ((s.flags & SHF_ALLOC) && s.type == SHT_NOBITS)
+			c = 'b';
+		else if ((s.flags & SHF_ALLOC) && !(s.flags & SHF_WRITE))
+			c = 'r';
+		else if (s.flags & SHF_ALLOC)
+			c = 'd';
+		else if (is_debug_section(e, &s))
+			return 'N';
+		else
+			c = 'n';
+	}
+
+	return bind == STB_GLOBAL ? c - 'a' + 'A' : c;
+}
+
+/*
+ * Returns 1 and fills rec for each symbol nm would list, 0 once the table
+ * is exhausted and -1 if a symbol's name lies outside .strtab.
+ */
+int elf_next_record(struct elf_symtab *e, struct nm_record *rec)
+{
+	const char *sym, *name, *end;
+	uint32_t name_off;
+	size_t shndx;
+	char stype;
+
+	for (; e->pos < e->nsyms; e->pos++) {
+		sym = e->syms + e->pos * e->sym_size;
+		name_off = RD_FIELD(e, sym, Sym, st_name, 32);
+		shndx = RD_FIELD(e, sym, Sym, st_shndx, 16);
+		if (shndx == SHN_XINDEX && e->xindex)
+			shndx = rd32(e, e->xindex + e->pos * sizeof(uint32_t));
+
+		stype = symbol_type(e, e->is64 ? sym[offsetof(Elf64_Sym, st_info)] :
+					  sym[offsetof(Elf32_Sym, st_info)], shndx);
+		if (!stype || !name_off)
+			continue;
+
+		if (name_off >= e->strtab_len)
+			return -1;
+		name = e->strtab + name_off;
+		end = memchr(name, '\0', e->strtab_len - name_off);
+		if (!end)
+			return -1;
+
+		rec->addr = RD_WORD(e, sym, Sym, st_value);
+		rec->name = name;
+		rec->name_len = end - name;
+		rec->stype = stype;
+		e->pos++;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef ELF_SYMTAB_H
+#define ELF_SYMTAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "nm_parser.h"
+
+/*
+ * Reads the symbols of an ELF image straight from its .symtab, keeping the
+ * order of the table, as the records nm would print for them. Names point
+ * into .strtab, so they live as long as the mapping they came from.
+ */
+struct elf_symtab {
+	const char	*buf;
+	size_t		len;
+	const char	*shdrs;		/* section header table */
+	size_t		shnum;
+	const char	*syms;
+	size_t		nsyms;
+	size_t		sym_size;
+	const char	*strtab;
+	size_t		strtab_len;
+	const char	*shstrtab;	/* section names, NULL if unusable */
+	size_t		shstrtab_len;
+	const char	*xindex;	/* SHT_SYMTAB_SHNDX, NULL if absent */
+	size_t		pos;
+	bool		is64;
+	bool		swap;		/* byte order differs from ours */
+};
+
+bool is_elf(const char *buf, size_t len);
+int elf_symtab_init(struct elf_symtab *e, const char *buf, size_t len);
+int elf_next_record(struct elf_symtab *e, struct nm_record *rec);
+#endif
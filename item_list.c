@@ -4,248 +4,360 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
-#include <assert.h>
+#include <endian.h>
+#include "arena.h"
 #include "item_list.h"
+#include "alloc.h"
+
+#define ITEM_LIST_MIN_CAPACITY 4096
+#define SMALL_SORT 32
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+struct sort_key {
+	uint64_t	key;
+	size_t		idx;
+};
+
+/* A run of keys still to be sorted on the name bytes from depth on. */
+struct name_run {
+	size_t		start;
+	size_t		n;
+	size_t		depth;
+};
+
+int item_list_reserve(struct item_list *list, size_t count)
+{
+	size_t capacity = list->capacity ? list->capacity : ITEM_LIST_MIN_CAPACITY;
+	struct item *items;
 
-struct item *list_index[96] = {0};
-#ifdef DEBUG
-int item_alloc_cnt;
+	if (count <= list->capacity)
+		return 1;
+	if (count > ITEM_LIST_MAX)
+		return 0;
 
-static inline void inc_item_cnt(void)
-{
-	item_alloc_cnt++;
-}
+	while (capacity < count)
+		capacity *= 2;
 
-static inline void dec_item_cnt(void)
-{
-	item_alloc_cnt--;
+	items = kas_realloc(list->items, list->capacity * sizeof(struct item),
+			    capacity * sizeof(struct item));
+	if (!items)
+		return 0;
+
+	list->items = items;
+	list->capacity = capacity;
+	return 1;
 }
 
-#else
+uint32_t name_hash(const char *name, size_t len)
+{
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+	uint64_t w;
 
-static inline void inc_item_cnt(void) {};
-static inline void dec_item_cnt(void) {};
+	for (; len >= sizeof(w); len -= sizeof(w), name += sizeof(w)) {
+		memcpy(&w, name, sizeof(w));
+		h = (h ^ w) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+	}
 
-#endif
+	for (w = 0; len; len--)
+		w = (w << 8) | (unsigned char)name[len - 1];
+	h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
 
+	return h ^ (h >> 29);
+}
 
-void build_index(struct item *list)
+/* Next eight name bytes starting at depth, big-endian, zero padded. */
+static inline uint64_t name_bytes(const char *name, size_t len, size_t depth)
 {
-	char current_first_letter = ' ';
-	struct item *current = list;
+	const unsigned char *p = (const unsigned char *)name + depth;
+	uint64_t key = 0;
+	size_t i;
 
-	while (current) {
-		if (current->symb_name[0] != current_first_letter) {
-			current_first_letter = current->symb_name[0];
-			list_index[current_first_letter - 32] = current;
-			}
-		current = current->next;
-		}
+	if (depth + sizeof(key) <= len) {
+		memcpy(&key, p, sizeof(key));
+		return be64toh(key);
+	}
+
+	for (i = 0; depth + i < len; i++)
+		key |= (uint64_t)p[i] << (56 - 8 * i);
 
+	return key;
 }
 
-struct item *add_item(struct item **list, const char *name, char stype, uint64_t addr)
+/*
+ * The name is referenced, not copied: it must outlive the list, as names
+ * inside a mapped input file do. NULL if memory ran out or the list holds
+ * ITEM_LIST_MAX items.
+ */
+struct item *add_item_ref(struct item_list *list, const char *name, size_t len,
+			  char stype, uint64_t addr)
 {
-	struct item *new_item = malloc(sizeof(struct item));
-	struct item *current;
+	struct item *new_item;
 
-	if (!new_item)
+	if (len > UINT32_MAX)
+		return NULL;
+	if (list->count == list->capacity && !item_list_reserve(list, list->count + 1))
 		return NULL;
 
-	inc_item_cnt();
-	strncpy(new_item->symb_name, name, MAX_NAME_SIZE);
-	new_item->symb_name[MAX_NAME_SIZE - 1] = '\0';
+	new_item = &list->items[list->count++];
+	new_item->symb_name = name;
+	new_item->name_len = len;
+	new_item->prefix = name_bytes(name, len, 0);
+	new_item->hash = name_hash(name, len);
 	new_item->addr = addr;
 	new_item->stype = stype;
-	new_item->next = NULL;
+	new_item->alias = 0;
+	new_item->obj = 0;
+	return new_item;
+}
 
-	if (!(*list)) {
-		*list = new_item;
-	} else {
-		current = *list;
-		while (current->next)
-			current = current->next;
+struct item *add_item(struct item_list *list, const char *name, size_t len,
+		      char stype, uint64_t addr)
+{
+	const char *new_name = arena_strndup(&list->names, name, len);
 
-		current->next = new_item;
-	}
-	return new_item;
+	if (!new_name)
+		return NULL;
+
+	return add_item_ref(list, new_name, len, stype, addr);
 }
 
-void sort_list(struct item **list, int sort_by)
+/*
+ * strcmp() order for names that need not be NUL terminated, from depth on.
+ * Names differing in their first eight bytes are told apart by prefix.
+ */
+static inline int name_cmp(const struct item *a, const struct item *b, size_t depth)
 {
-	struct item *current = *list;
-	struct item *sorted = NULL;
-	struct item *next_item;
-	struct item *temp;
-
-	if (!(*list) || !((*list)->next))
-		return;
-
-	while (current) {
-		next_item = current->next;
-		if (!sorted ||
-		    (sort_by == BY_ADDRESS && current->addr < sorted->addr) ||
-		    (sort_by == BY_NAME && strcmp(current->symb_name, sorted->symb_name) < 0)) {
-			current->next = sorted;
-			sorted = current;
-		} else {
-			temp = sorted;
-			while (temp->next &&
-			      ((sort_by == BY_ADDRESS && current->addr >= temp->next->addr) ||
-			      (sort_by == BY_NAME &&
-			      strcmp(current->symb_name, temp->next->symb_name) >= 0))) {
-
-				temp = temp->next;
-				}
-
-			current->next = temp->next;
-			temp->next = current;
-		}
-		current = next_item;
-	}
+	size_t len = a->name_len < b->name_len ? a->name_len : b->name_len;
+	int ret = 0;
+
+	if (!depth && a->prefix != b->prefix)
+		return a->prefix < b->prefix ? -1 : 1;
+
+	if (len > depth)
+		ret = memcmp(a->symb_name + depth, b->symb_name + depth, len - depth);
 
-	*list = sorted;
+	return ret ? ret : (a->name_len > b->name_len) - (a->name_len < b->name_len);
 }
 
-struct item *merge(struct item *left, struct item *right, int sort_by)
+static inline bool addr_after(const struct item *a, const struct item *b)
 {
-	struct item *current = NULL;
-	struct item *result = NULL;
+	return a->addr > b->addr;
+}
 
-	if (!left)
-		return right;
-	if (!right)
-		return left;
+static inline bool name_after(const struct item *a, const struct item *b)
+{
+	return name_cmp(a, b, 0) > 0;
+}
 
-	if (sort_by == BY_NAME) {
-		if (strcmp(left->symb_name, right->symb_name) <= 0) {
-			result = left;
-			left = left->next;
-		} else {
-			result = right;
-			right = right->next;
-		}
-	} else {
-		if (sort_by == BY_ADDRESS) {
-			if (left->addr <= right->addr) {
-				result = left;
-				left = left->next;
-			} else {
-				result = right;
-				right = right->next;
-			}
-		}
-	}
+/*
+ * Stable insertion sort, for inputs too small to be worth a radix pass.
+ * One instance per key, so the compare is inlined into the loop.
+ */
+#define DEFINE_INSERTION_SORT(fn, after)				\
+static void fn(struct item *items, size_t count)			\
+{									\
+	struct item current;						\
+	size_t i, j;							\
+									\
+	for (i = 1; i < count; i++) {					\
+		current = items[i];					\
+		for (j = i; j > 0 && after(&items[j - 1], &current); j--) \
+			items[j] = items[j - 1];			\
+		items[j] = current;					\
+	}								\
+}
 
-	current = result;
+DEFINE_INSERTION_SORT(insertion_sort_by_addr, addr_after)
+DEFINE_INSERTION_SORT(insertion_sort_by_name, name_after)
 
-	while (left && right) {
-		if (sort_by == BY_NAME) {
-			if (strcmp(left->symb_name, right->symb_name) <= 0) {
-				current->next = left;
-				left = left->next;
-			} else {
-				current->next = right;
-				right = right->next;
-			}
-		} else {
-			if (sort_by == BY_ADDRESS) {
-				if (left->addr <= right->addr) {
-					current->next = left;
-					left = left->next;
-				} else {
-					current->next = right;
-					right = right->next;
-				}
-			}
+/*
+ * LSD radix sort on the 64-bit keys. Digits on which every key agrees are
+ * skipped, which for kernel addresses drops the constant high bytes.
+ * The sort is stable, so equal keys keep their input order.
+ */
+static void radix_sort_keys(struct sort_key *keys, struct sort_key *tmp, size_t n)
+{
+	struct sort_key *src = keys, *dst = tmp, *swap;
+	size_t hist[RADIX_PASSES][RADIX_BUCKETS];
+	unsigned int shift;
+	size_t i, sum, cnt;
+	int pass, b;
+
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < n; i++)
+		for (pass = 0; pass < RADIX_PASSES; pass++)
+			hist[pass][(keys[i].key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+
+	for (pass = 0; pass < RADIX_PASSES; pass++) {
+		shift = pass * RADIX_BITS;
+		if (hist[pass][(src[0].key >> shift) & (RADIX_BUCKETS - 1)] == n)
+			continue;
+
+		for (sum = 0, b = 0; b < RADIX_BUCKETS; b++) {
+			cnt = hist[pass][b];
+			hist[pass][b] = sum;
+			sum += cnt;
 		}
 
-		current = current->next;
-	}
+		for (i = 0; i < n; i++)
+			dst[hist[pass][(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
 
-	if (left) {
-		current->next = left;
-	} else {
-		if (right)
-			current->next = right;
+		swap = src;
+		src = dst;
+		dst = swap;
 	}
 
-	return result;
+	if (src != keys)
+		memcpy(keys, src, n * sizeof(struct sort_key));
 }
 
-struct item *merge_sort(struct item *head, int sort_by)
+/* The radix digit of a name at depth; the first one is kept in the item. */
+static inline uint64_t name_key(const struct item *item, size_t depth)
 {
-	struct item *right;
-	struct item *slow;
-	struct item *fast;
-	struct item *left;
+	if (!depth)
+		return item->prefix;
+	return name_bytes(item->symb_name, item->name_len, depth);
+}
 
-	if (!head || !head->next)
-		return head;
+static void insertion_sort_names(const struct item *items, struct sort_key *keys,
+				 size_t n, size_t depth)
+{
+	struct sort_key current;
+	size_t i, j;
+
+	for (i = 1; i < n; i++) {
+		current = keys[i];
+		for (j = i; j > 0 &&
+		     name_cmp(&items[keys[j - 1].idx], &items[current.idx], depth) > 0; j--)
+			keys[j] = keys[j - 1];
+		keys[j] = current;
+	}
+}
 
-	slow = head;
-	fast = head->next;
+static int push_run(struct name_run **stack, size_t *len, size_t *cap,
+		    size_t start, size_t n, size_t depth)
+{
+	struct name_run *tmp;
+
+	if (*len == *cap) {
+		tmp = kas_realloc(*stack, *cap * sizeof(*tmp), *cap * 2 * sizeof(*tmp));
+		if (!tmp)
+			return 0;
+		*stack = tmp;
+		*cap *= 2;
+	}
+	(*stack)[*len].start = start;
+	(*stack)[*len].n = n;
+	(*stack)[*len].depth = depth;
+	(*len)++;
+	return 1;
+}
 
-	while (fast && fast->next) {
-		slow = slow->next;
-		fast = fast->next->next;
+/*
+ * Sort by eight-byte name prefixes; runs sharing a prefix that does not
+ * end the names are sorted again on the following eight bytes, so most
+ * of the work is integer radix passes rather than string compares. The
+ * runs wait on a stack of their own rather than the call stack, which
+ * long shared prefixes would make deep. Returns 0 if memory ran out.
+ */
+static int radix_sort_names(const struct item *items, struct sort_key *keys,
+			    struct sort_key *tmp, size_t n)
+{
+	size_t i, run, len = 0, cap = 64;
+	struct name_run *stack, r;
+	struct sort_key *k;
+	int ret = 1;
+
+	stack = kas_malloc(cap * sizeof(*stack));
+	if (!stack || !push_run(&stack, &len, &cap, 0, n, 0)) {
+		kas_free(stack);
+		return 0;
 	}
 
-	left = head;
-	right = slow->next;
-	slow->next = NULL;
+	while (len) {
+		r = stack[--len];
+		k = keys + r.start;
+		if (r.n < SMALL_SORT) {
+			insertion_sort_names(items, k, r.n, r.depth);
+			continue;
+		}
+
+		for (i = 0; i < r.n; i++)
+			k[i].key = name_key(&items[k[i].idx], r.depth);
 
-	left = merge_sort(left, sort_by);
-	right = merge_sort(right, sort_by);
+		radix_sort_keys(k, tmp, r.n);
 
-	return merge(left, right, sort_by);
+		for (i = 0; i < r.n; i = run) {
+			for (run = i + 1; run < r.n && k[run].key == k[i].key; run++)
+				;
+			if (run - i > 1 && (k[i].key & 0xff) &&
+			    !push_run(&stack, &len, &cap, r.start + i, run - i, r.depth + 8)) {
+				ret = 0;
+				goto out;
+			}
+		}
+	}
+out:
+	kas_free(stack);
+	return ret;
 }
 
-void sort_list_m(struct item **head, int sort_by)
+int sort_list_m(struct item_list *list, int sort_by)
 {
-	if (!(*head) || !((*head)->next))
-		return;
+	struct sort_key *keys;
+	struct item *sorted;
+	size_t i, n = list->count;
+
+	if (n < SMALL_SORT) {
+		if (sort_by == BY_NAME)
+			insertion_sort_by_name(list->items, n);
+		else
+			insertion_sort_by_addr(list->items, n);
+		return 1;
+	}
 
-	*head = merge_sort(*head, sort_by);
-}
+	keys = kas_malloc(2 * n * sizeof(struct sort_key));
+	sorted = kas_malloc(n * sizeof(struct item));
+	if (!keys || !sorted) {
+		kas_free(keys);
+		kas_free(sorted);
+		return 0;
+	}
 
-int insert_after(struct item *list, const uint64_t search_addr,
-		 const char *name, uint64_t addr, char stype)
-{
-	struct item *new_item;
-	struct item *current;
-	int ret = 0;
+	for (i = 0; i < n; i++) {
+		keys[i].key = list->items[i].addr;
+		keys[i].idx = i;
+	}
 
-	current = (list_index[name[0] - 32]) ? list_index[name[0] - 32] : list;
-	while (current) {
-		if (current->addr == search_addr) {
-			inc_item_cnt();
-			new_item = malloc(sizeof(struct item));
-			if (!new_item)
-				return ret;
-			strncpy(new_item->symb_name, name, MAX_NAME_SIZE);
-			new_item->symb_name[MAX_NAME_SIZE - 1] = '\0';
-			new_item->addr = addr;
-			new_item->stype = stype;
-			new_item->next = current->next;
-			current->next = new_item;
-			ret = 1;
-			break;
+	if (sort_by == BY_NAME) {
+		if (!radix_sort_names(list->items, keys, keys + n, n)) {
+			kas_free(keys);
+			kas_free(sorted);
+			return 0;
 		}
-		current = current->next;
+	} else {
+		radix_sort_keys(keys, keys + n, n);
 	}
-	return ret;
+
+	for (i = 0; i < n; i++)
+		sorted[i] = list->items[keys[i].idx];
+
+	kas_free(keys);
+	kas_free(list->items);
+	/* the copy drops the slack doubling left, as the list is complete */
+	list->items = sorted;
+	list->capacity = n;
+	return 1;
 }
 
-void free_items(struct item **head)
+void free_items(struct item_list *list)
 {
-	struct item *app, *item_iterator = *head;
-
-	while (item_iterator) {
-		app = item_iterator;
-		item_iterator = item_iterator->next;
-		free(app);
-		dec_item_cnt();
-	}
-	*head = NULL;
+	kas_free(list->items);
+	arena_release(&list->names);
+	list->items = NULL;
+	list->count = 0;
+	list->capacity = 0;
 }
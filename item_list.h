@@ -2,27 +2,56 @@
 #ifndef ITEM_LIST_H
 #define ITEM_LIST_H
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 
-#include "debug.h"
+#include "arena.h"
 
-#define MAX_NAME_SIZE 256
 #define BY_ADDRESS 1
 #define BY_NAME 2
 
+/* Items are indexed with 32 bits where that keeps tables small. */
+#define ITEM_LIST_MAX UINT32_MAX
+
+/*
+ * Compact symbol record. The name lives in the list's string arena or in
+ * the mapped input file and is not NUL terminated. The records themselves
+ * sit in one contiguous array so that sorting and scanning walk memory
+ * sequentially. prefix and hash are computed once, while the name is
+ * still in cache from parsing: name order and name equality are mostly
+ * decided on them without touching the name again.
+ */
 struct item {
-	char		symb_name[MAX_NAME_SIZE];
 	uint64_t	addr;
+	const char	*symb_name;
+	uint64_t	prefix;		/* first eight name bytes, big-endian, zero padded */
+	uint32_t	name_len;
+	uint32_t	hash;		/* name_hash() of the name */
+	uint32_t	alias;		/* ordinal among same-named symbols, 0 if unique */
+	uint32_t	obj;		/* linker map file + 1 naming the alias, or 0 */
 	char		stype;
-	struct item	*next;
 };
 
-void build_index(struct item *list);
-struct item *add_item(struct item **list, const char *name, char stype, uint64_t addr);
-void sort_list(struct item **list, int sort_by);
-struct item *merge(struct item *left, struct item *right, int sort_by);
-struct item *merge_sort(struct item *head, int sort_by);
-void sort_list_m(struct item **head, int sort_by);
-int insert_after(struct item *list, const uint64_t search_addr,
-		 const char *name, uint64_t addr, char stype);
-void free_items(struct item **head);
+struct item_list {
+	struct item	*items;
+	size_t		count;
+	size_t		capacity;
+	struct arena	names;
+};
+
+uint32_t name_hash(const char *name, size_t len);
+struct item *add_item(struct item_list *list, const char *name, size_t len,
+		      char stype, uint64_t addr);
+struct item *add_item_ref(struct item_list *list, const char *name, size_t len,
+			  char stype, uint64_t addr);
+int item_list_reserve(struct item_list *list, size_t count);
+int sort_list_m(struct item_list *list, int sort_by);
+void free_items(struct item_list *list);
+
+static inline bool same_name(const struct item *a, const struct item *b)
+{
+	return a->hash == b->hash && a->name_len == b->name_len &&
+	       memcmp(a->symb_name, b->symb_name, a->name_len) == 0;
+}
 #endif
@@ -1,102 +1,710 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "item_list.h"
 #include "duplicates_list.h"
+#include "nm_parser.h"
+#include "elf_symtab.h"
+#include "output.h"
+#include "kas_bin.h"
+#include "kas_index.h"
+#include "linker_map.h"
+#include "alias_state.h"
+#include "alias_filter.h"
+#include "multi_input.h"
+#include "parallel.h"
+#include "stats.h"
+#include "alloc.h"
 
-int suffix_serial;
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s <nmfile|elf|-> [-o <outfile>] [-binary] [-index <indexfile>]\n"
+		"       [-map <linker map>] [-state <statefile>] [-j <jobs>]\n"
+		"       [-text-only] [-skip-pfx] [-alias-list <listfile>]\n"
+		"       [-stats|-stats-json] [-verbose]\n"
+		"       %s <inputlist> -multi [-j <jobs>] [-text-only] [-skip-pfx]\n"
+		"       [-alias-list <listfile>] [-stats|-stats-json] [-verbose]\n", prog, prog);
+}
+
+/* Writes one alias line and counts it. */
+static void emit_alias(struct output *out, const char *name, size_t name_len, char stype,
+		       uint64_t addr, uint32_t ordinal)
+{
+	out_alias(out, addr, stype, name, name_len, ordinal);
+	kas_stats.aliases++;
+	if (ordinal == 1)
+		kas_stats.groups++;
+	if (ordinal > kas_stats.largest_group)
+		kas_stats.largest_group = ordinal;
+}
+
+/*
+ * Numbers every item of an address sorted list whose name the state file
+ * recorded as a duplicate and fingerprints the symbol set. Returns true
+ * if the recorded groups can be reused as they are; otherwise the numbers
+ * are cleared again.
+ */
+static bool apply_state(struct item_list *list, struct alias_state *st)
+{
+	struct alias_group *group;
+	struct item *item;
+	bool reuse;
+	size_t i;
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		alias_state_count(st, item->symb_name, item->name_len);
+		group = alias_state_group(st, item->symb_name, item->name_len, item->hash);
+		if (group)
+			item->alias = alias_state_ordinal(st, group);
+	}
+
+	reuse = alias_state_matches(st);
+	if (!reuse && st->loaded)
+		for (i = 0; i < list->count; i++)
+			list->items[i].alias = 0;
+
+	return reuse;
+}
+
+/*
+ * Streaming mode, used when reading stdin: every symbol is written as soon
+ * as it is read, and aliases as soon as a name shows up a second time, so
+ * an alias may follow later symbols. Only the first occurrence of each
+ * name is remembered. scripts/kallsyms sorts its input, so it does not
+ * care about the order.
+ *
+ * A state file is not used here: whether it still matches is only known
+ * at the end of the input, after its aliases would have been written, so
+ * -state reads stdin whole instead. The input is expected in address
+ * order, as the ordinals follow it. First occurrences are kept in seen,
+ * which the caller frees. Returns 0 on success and -1 on a read error, a
+ * line that does not parse or if memory ran out.
+ */
+static int alias_stream(struct nm_parser *parser, struct output *out, struct item_list *seen)
+{
+	struct dup_entry *entry;
+	struct dup_table table;
+	struct nm_record rec;
+	struct item *first;
+	uint32_t hash;
+	int ret;
+
+	if (!dup_table_init(&table, 0))
+		return -1;
+
+	while ((ret = nm_next_record(parser, &rec)) > 0) {
+		kas_stats.symbols++;
+		out_symbol(out, rec.addr, rec.stype, rec.name, rec.name_len, "", 0);
+
+		hash = name_hash(rec.name, rec.name_len);
+		entry = dup_table_insert(&table, rec.name, rec.name_len, hash);
+		if (!entry) {
+			ret = -1;
+			break;
+		}
+
+		if (!entry->count++) {
+			first = add_item(seen, rec.name, rec.name_len, rec.stype, rec.addr);
+			if (!first) {
+				ret = -1;
+				break;
+			}
+			entry->name = first->symb_name;
+			entry->first = seen->count - 1;
+			continue;
+		}
+
+		first = &seen->items[entry->first];
+		if (entry->count == 2)
+			emit_alias(out, first->symb_name, first->name_len, first->stype,
+				   first->addr, 1);
+		emit_alias(out, first->symb_name, first->name_len, rec.stype, rec.addr,
+			   entry->count);
+	}
+
+	dup_table_free(&table);
+	return ret < 0 || parser->malformed ? -1 : 0;
+}
+
+static bool has_aliases(const struct item_list *list)
+{
+	size_t i;
+
+	for (i = 0; i < list->count; i++)
+		if (list->items[i].alias)
+			return true;
+	return false;
+}
+
+/*
+ * Reads the whole input into list, from the ELF symbol table if elf is
+ * set and from nm text otherwise. With dups, each symbol is numbered
+ * among its name's as it is added, which for input in address order is
+ * the whole duplicate search. Returns 1 on success, 0 if memory ran out
+ * and -1 on a read error.
+ */
+static int parse_input(struct nm_parser *parser, struct elf_symtab *elf, struct item_list *list,
+		       struct dup_table *dups, bool *addr_sorted)
+{
+	struct nm_record rec;
+	size_t numbered = 0;
+	struct item *item;
+	int ret;
+
+	while ((ret = elf ? elf_next_record(elf, &rec) : nm_next_record(parser, &rec)) > 0) {
+		if (list->count && rec.addr < list->items[list->count - 1].addr) {
+			/* the numbers are cleared again, stop giving them */
+			*addr_sorted = false;
+			dups = NULL;
+		}
+		if (parser->mapped)
+			item = add_item_ref(list, rec.name, rec.name_len, rec.stype, rec.addr);
+		else
+			item = add_item(list, rec.name, rec.name_len, rec.stype, rec.addr);
+		if (!item)
+			return 0;
+		if (dups && list->count - numbered == DUP_NUMBER_BATCH &&
+		    !dup_table_number(dups, list, &numbered))
+			return 0;
+	}
+
+	if (dups && ret >= 0 && !dup_table_number(dups, list, &numbered))
+		return 0;
+	return ret < 0 ? -1 : 1;
+}
+
+/* The index is written next to the table, under the same run of the output timer. */
+static int write_index(const char *path, const struct item_list *list,
+		       const struct linker_map *map)
+{
+	struct output out;
+	int fd, ret;
 
-static void create_suffix(const char *name, char *output_suffix)
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return 0;
+	if (!out_init(&out, fd)) {
+		close(fd);
+		return 0;
+	}
+
+	out.map = map;
+	ret = kas_index_write(&out, list);
+	ret = out_flush(&out) && ret;
+	out_free(&out);
+	return !close(fd) && ret;
+}
+
+static int timed_sort(struct item_list *list, int sort_by)
+{
+	struct stats_timer t;
+	int ret;
+
+	stats_start(&t);
+	ret = sort_list_m(list, sort_by);
+	stats_stop(&t, PHASE_SORT);
+	return ret;
+}
+
+static int multi_error(const struct multi_run *r, int ret)
 {
-	sprintf(output_suffix, "%s__alias__%d", name, suffix_serial++);
+	if (!ret)
+		fprintf(stderr, "Error in allocate memory\n");
+	else if (ret == MULTI_EWRITE)
+		fprintf(stderr, "Can't write output file %s.\n", r->bad);
+	else
+		fprintf(stderr, "Can't read input file %s.\n", r->bad);
+	return 1;
+}
+
+/*
+ * -multi: vmlinux and its modules are aliased as one symbol set, each
+ * input getting its own table. The duplicates are scanned in list order,
+ * every input being in address order by then.
+ */
+static int run_multi(const char *list_path, int jobs, struct alias_filter *filter,
+		     const char *filter_list, bool stats, bool verbose_mode)
+{
+	struct multi_run run;
+	struct stats_timer t;
+	struct item *item;
+	size_t i;
+	int ret;
+
+	if (filter_list) {
+		ret = alias_filter_load(filter, filter_list);
+		if (ret <= 0) {
+			fprintf(stderr, ret ? "Can't read alias list.\n" : "Error in allocate memory\n");
+			return 1;
+		}
+	}
+
+	ret = multi_load(&run, list_path);
+	if (ret <= 0)
+		return multi_error(&run, ret);
+	verbose_msg(verbose_mode, "Scanning %zu inputs\n", run.count);
+
+	stats_start(&t);
+	ret = multi_parse(&run, jobs);
+	if (ret > 0)
+		ret = multi_join(&run);
+	stats_stop(&t, PHASE_PARSE);
+	if (ret <= 0)
+		return multi_error(&run, ret);
+	kas_stats.symbols = run.list.count;
+
+	verbose_msg(verbose_mode, "Scanning nm data for duplicates\n");
+	stats_start(&t);
+	if (jobs > 1)
+		ret = parallel_find_duplicates(&run.list, jobs);
+	else
+		ret = find_duplicates_hash(&run.list);
+	if (ret && alias_filter_active(filter))
+		ret = alias_filter_apply(filter, &run.list);
+	stats_stop(&t, PHASE_DEDUP);
+	if (!ret)
+		return multi_error(&run, 0);
+
+	for (i = 0; stats && i < run.list.count; i++) {
+		item = &run.list.items[i];
+		if (!item->alias)
+			continue;
+		kas_stats.aliases++;
+		if (item->alias == 1)
+			kas_stats.groups++;
+		if (item->alias > kas_stats.largest_group)
+			kas_stats.largest_group = item->alias;
+	}
+
+	verbose_msg(verbose_mode, "Writing %zu symbols\n", run.list.count);
+	stats_start(&t);
+	ret = multi_write(&run, jobs);
+	stats_stop(&t, PHASE_OUTPUT);
+	if (ret <= 0)
+		return multi_error(&run, ret);
+
+	multi_free(&run);
+	return 0;
 }
 
 int main(int argc, char *argv[])
 {
-	char t, sym_name[MAX_NAME_SIZE], new_name[MAX_NAME_SIZE + 15];
-	PRINT_STATS_DPL struct duplicate_item *duplicate;
-	struct duplicate_item  *duplicate_iterator;
-	PRINT_STATS_ITM struct item *head = {NULL};
+	struct item_list list = {0};
+	const char *state_name = NULL;
+	const char *map_name = NULL;
+	const char *index_name = NULL;
+	struct linker_map map = {0};
+	struct alias_filter filter = {0};
+	const char *list_name = NULL;
+	const char *out_name = NULL;
+	struct alias_state state = {0};
+	struct elf_symtab *elf = NULL;
+	struct elf_symtab symtab;
+	struct dup_table dups;
 	bool need_2_process = true;
-	struct item *last = {NULL};
-	struct item  *current;
+	bool use_state = false;
+	bool processed = false;
+	bool addr_sorted = true;
+	bool numbered = false;
+	bool fused = false;
+	bool in_order;
+	bool stats_json = false;
+	bool binary = false;
+	bool multi = false;
+	struct nm_parser parser;
+	bool stats = false;
+	struct stats_timer t;
+	bool stream;
+	struct output out;
+	struct item *item;
 	int verbose_mode = 0;
-	uint64_t address;
-	FILE *fp;
+	int fd, out_fd = 1;
+	int jobs = 1;
+	size_t i;
+	int ret;
+
+#ifdef FAULT_INJECTION
+	/* KAS_ALIAS_FAIL_ALLOC=n makes the n-th allocation fail */
+	static struct fault_allocator fault;
+	const char *fail_at = getenv("KAS_ALIAS_FAIL_ALLOC");
 
-	if (argc < 2 || argc > 3) {
-		printf("Usage: %s <nmfile> [-verbose]\n", argv[0]);
+	if (fail_at) {
+		fault_allocator_init(&fault, strtoul(fail_at, NULL, 10));
+		kas_set_allocator(&fault.ops);
+	}
+#endif
+
+	if (argc < 2) {
+		usage(argv[0]);
 		return 1;
 	}
 
-	if (argc == 3 && strcmp(argv[2], "-verbose") == 0)
-		verbose_mode = 1;
+	for (i = 2; i < (size_t)argc; i++) {
+		if (strcmp(argv[i], "-verbose") == 0) {
+			verbose_mode = 1;
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < (size_t)argc) {
+			out_name = argv[++i];
+		} else if (strcmp(argv[i], "-binary") == 0) {
+			binary = true;
+		} else if (strcmp(argv[i], "-multi") == 0) {
+			multi = true;
+		} else if (strcmp(argv[i], "-index") == 0 && i + 1 < (size_t)argc) {
+			index_name = argv[++i];
+		} else if (strcmp(argv[i], "-map") == 0 && i + 1 < (size_t)argc) {
+			map_name = argv[++i];
+		} else if (strcmp(argv[i], "-text-only") == 0) {
+			filter.text_only = true;
+		} else if (strcmp(argv[i], "-skip-pfx") == 0) {
+			filter.skip_pfx = true;
+		} else if (strcmp(argv[i], "-alias-list") == 0 && i + 1 < (size_t)argc) {
+			list_name = argv[++i];
+		} else if (strcmp(argv[i], "-state") == 0 && i + 1 < (size_t)argc) {
+			state_name = argv[++i];
+		} else if (strcmp(argv[i], "-stats") == 0) {
+			stats = true;
+		} else if (strcmp(argv[i], "-stats-json") == 0) {
+			stats = true;
+			stats_json = true;
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < (size_t)argc) {
+			jobs = atoi(argv[++i]);
+			if (jobs < 1 || jobs > MAX_JOBS) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/* every input of a -multi run is written to a file of its own */
+	if (multi && (out_name || binary || index_name || map_name || state_name)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (multi) {
+		ret = run_multi(argv[1], jobs, &filter, list_name, stats, verbose_mode);
+		if (!ret && stats)
+			stats_print(stderr, stats_json);
+		alias_filter_free(&filter);
+		return ret;
+	}
 
 	verbose_msg(verbose_mode, "Scanning nm data(%s)\n", argv[1]);
 
-	fp = fopen(argv[1], "r");
-	if (!fp) {
-		printf("Can't open input file.\n");
+	/*
+	 * A binary table or index is written whole, object names and the
+	 * __pfx_ rule need every alias known, and a state file can only be
+	 * trusted once all names were seen, so stdin is then read into memory
+	 * first.
+	 */
+	stream = strcmp(argv[1], "-") == 0 && !binary && !index_name && !map_name &&
+		 !state_name && !filter.text_only && !filter.skip_pfx && !list_name;
+	fd = strcmp(argv[1], "-") == 0 ? 0 : open(argv[1], O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Can't open input file.\n");
 		return 1;
 	}
 
-	while (fscanf(fp, "%lx %c %99s\n", &address, &t, sym_name) == 3) {
-		if (strstr(sym_name, "__alias__1") != NULL) {
-			if (verbose_mode && need_2_process)
-				printf("Already processed\n");
-			need_2_process = false;
-			}
-		last = add_item(&last, sym_name, t, address);
-		if (!last) {
-			printf("Error in allocate memory\n");
-			free_items(&head);
+	if (out_name) {
+		out_fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (out_fd < 0) {
+			fprintf(stderr, "Can't open output file.\n");
 			return 1;
 		}
+	}
 
-		if (!head)
-			head = last;
+	if (!nm_parser_init(&parser, fd) || !out_init(&out, out_fd)) {
+		fprintf(stderr, "Error in allocate memory\n");
+		return 1;
+	}
+
+	/* an ELF image is read through its symbol table, as nm would */
+	if (parser.mapped && is_elf(parser.buf, parser.len)) {
+		if (!elf_symtab_init(&symtab, parser.buf, parser.len)) {
+			fprintf(stderr, "No symbol table in input file.\n");
+			return 1;
+		}
+		elf = &symtab;
+		verbose_msg(verbose_mode, "Reading ELF symbol table\n");
+	}
+
+	/*
+	 * Only a text table can be passed on as it is; the other outputs
+	 * still need the symbols, less the marker.
+	 */
+	processed = !elf && skip_marker(&parser);
+	if (processed)
+		verbose_msg(verbose_mode, "Already processed\n");
+	if (processed && !binary && !index_name) {
+		need_2_process = false;
+		stats_start(&t);
+		if (out_pass_through(&out, &parser) < 0) {
+			fprintf(stderr, "Error reading input file.\n");
+			return 1;
+		}
+		goto flush;
+	}
+
+	if (map_name) {
+		stats_start(&t);
+		ret = linker_map_load(&map, map_name);
+		if (ret <= 0) {
+			fprintf(stderr, ret ? "Can't read linker map.\n" : "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_MAP);
+		out.map = &map;
+		verbose_msg(verbose_mode, "Linker map: %zu sections in %zu objects\n",
+			    map.count, map.nfiles);
+	}
+
+	if (list_name) {
+		ret = alias_filter_load(&filter, list_name);
+		if (ret <= 0) {
+			fprintf(stderr, ret ? "Can't read alias list.\n" : "Error in allocate memory\n");
+			return 1;
+		}
+	}
+
+	if (state_name) {
+		stats_start(&t);
+		if (!alias_state_load(&state, state_name)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_STATE);
+		verbose_msg(verbose_mode, "Alias state %s\n", state.loaded ? "loaded" : "not found");
+	}
+
+	if (stream) {
+		stats_start(&t);
+		out_marker(&out);
+		ret = alias_stream(&parser, &out, &list);
+		stats_stop(&t, PHASE_STREAM);
+		if (ret < 0) {
+			fprintf(stderr, "Error reading input file.\n");
+			return 1;
+		}
+		goto flush;
+	}
+
+	stats_start(&t);
+	if (jobs > 1 && parser.mapped && !elf) {
+		verbose_msg(verbose_mode, "Parsing with %d jobs\n", jobs);
+		ret = parallel_parse(&list, &parser, jobs, &addr_sorted);
+	} else if (!processed && !state_name) {
+		/*
+		 * Duplicates are numbered while parsing, which is right if the
+		 * input turns out to be in address order as nm -n writes it.
+		 * About 40 bytes of nm text per name sizes the table.
+		 */
+		ret = dup_table_init(&dups, elf ? 0 : parser.len / 40);
+		if (ret)
+			ret = parse_input(&parser, elf, &list, &dups, &addr_sorted);
+		dup_table_free(&dups);
+		fused = true;
+	} else {
+		ret = parse_input(&parser, elf, &list, NULL, &addr_sorted);
 	}
+	stats_stop(&t, PHASE_PARSE);
+	kas_stats.symbols = list.count;
 
-	fclose(fp);
+	/* a line that does not parse would leave the rest of the table out */
+	if (ret > 0 && parser.malformed)
+		ret = -1;
+	if (ret <= 0) {
+		fprintf(stderr, ret ? "Error reading input file.\n" : "Error in allocate memory\n");
+		return 1;
+	}
 
-	if (need_2_process) {
+	need_2_process = !processed;
+	in_order = addr_sorted;
+
+	/* the numbers follow input order, so they only stand if that was address order */
+	numbered = fused && addr_sorted;
+	for (i = 0; fused && !numbered && i < list.count; i++)
+		list.items[i].alias = 0;
+
+	if (need_2_process && state_name) {
+		/* ordinals follow addresses; sorting first also enables the hash path */
+		if (!addr_sorted) {
+			verbose_msg(verbose_mode, "Sorting nm data\n");
+			if (!timed_sort(&list, BY_ADDRESS)) {
+				fprintf(stderr, "Error in allocate memory\n");
+				return 1;
+			}
+			addr_sorted = true;
+		}
+		stats_start(&t);
+		use_state = apply_state(&list, &state);
+		stats_stop(&t, PHASE_STATE);
+		if (use_state)
+			verbose_msg(verbose_mode, "Reusing alias state\n");
+	}
+
+	if (use_state) {
+		/* duplicates already numbered from the state file */
+	} else if (numbered) {
+		/* duplicates numbered while parsing */
+	} else if (need_2_process && jobs > 1 && addr_sorted) {
+		/*
+		 * The sharded scan numbers in list order. Unordered input takes
+		 * the name sort below, which also orders symbols that share an
+		 * address.
+		 */
+		verbose_msg(verbose_mode, "Scanning nm data for duplicates\n");
+		stats_start(&t);
+		if (!parallel_find_duplicates(&list, jobs)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_DEDUP);
+	} else if (need_2_process && addr_sorted) {
+		/*
+		 * nm -n output: no sorting needed, aliases are emitted right
+		 * after their symbol while printing.
+		 */
+		verbose_msg(verbose_mode, "Scanning nm data for duplicates\n");
+		stats_start(&t);
+		if (!find_duplicates_hash(&list)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_DEDUP);
+	} else if (need_2_process) {
 		verbose_msg(verbose_mode, "Sorting nm data\n");
-		sort_list_m(&head, BY_NAME);
+		if (!timed_sort(&list, BY_NAME)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
 		verbose_msg(verbose_mode, "Scanning nm data for duplicates\n");
-		duplicate = find_duplicates(head);
-		if (!duplicate) {
-			printf("Error in duplicates list\n");
+		stats_start(&t);
+		find_duplicates(&list);
+		stats_stop(&t, PHASE_DEDUP);
+
+		if (!timed_sort(&list, BY_ADDRESS)) {
+			fprintf(stderr, "Error in allocate memory\n");
 			return 1;
 		}
+	}
 
-		verbose_msg(verbose_mode, "Applying suffixes\n");
-		build_index(head);
-		duplicate_iterator = duplicate;
-		while (duplicate_iterator) {
-			create_suffix(duplicate_iterator->original_item->symb_name, new_name);
-			if (!insert_after(head, duplicate_iterator->original_item->addr, new_name,
-					  duplicate_iterator->original_item->addr,
-					  duplicate_iterator->original_item->stype))
-				return 1;
-			duplicate_iterator = duplicate_iterator->next;
+	/* the state keeps every group, so a later run may change the filter */
+	for (i = 0; state_name && need_2_process && !use_state && i < list.count; i++) {
+		item = &list.items[i];
+		if (item->alias && !alias_state_log(&state, item->symb_name, item->name_len)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
 		}
+	}
 
-		sort_list_m(&head, BY_ADDRESS);
+	if (need_2_process && alias_filter_active(&filter)) {
+		stats_start(&t);
+		if (!alias_filter_apply(&filter, &list)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_DEDUP);
 	}
-	current = head;
-	while (current) {
-		printf("%08lx %c %s\n", current->addr, current->stype, current->symb_name);
-		current = current->next;
+
+	if (need_2_process && map_name) {
+		stats_start(&t);
+		if (!linker_map_name_aliases(&map, &list)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+		stats_stop(&t, PHASE_MAP);
+	}
+
+	/* the table is searched by address; processed input may come in any order */
+	if (binary && !addr_sorted && !need_2_process && !timed_sort(&list, BY_ADDRESS)) {
+		fprintf(stderr, "Error in allocate memory\n");
+		return 1;
 	}
 
-	free_items(&head);
-	free_duplicates(&duplicate);
+	verbose_msg(verbose_mode, "Writing %zu symbols\n", list.count);
+	stats_start(&t);
+	if (binary) {
+		if (!kas_bin_write(&out, &list)) {
+			fprintf(stderr, "Symbol table too large for binary output.\n");
+			return 1;
+		}
+	} else if (parser.mapped && !elf && !parser.skipped && in_order && !has_aliases(&list)) {
+		/* nothing to add or leave out: the table is the input file as it is */
+		verbose_msg(verbose_mode, "No aliases, copying the input\n");
+		if (!processed)
+			out_marker(&out);
+		out_copy(&out, parser.fd, 0, parser.buf, parser.len);
+	} else if (jobs > 1) {
+		out_marker(&out);
+		if (!parallel_write(&out, &list, jobs)) {
+			fprintf(stderr, "Error in allocate memory\n");
+			return 1;
+		}
+	} else {
+		out_marker(&out);
+		for (i = 0; i < list.count; i++)
+			out_item(&out, &list.items[i]);
+	}
+
+	/* counted for -stats only */
+	for (i = 0; stats && i < list.count; i++) {
+		item = &list.items[i];
+		if (!item->alias)
+			continue;
+		kas_stats.aliases++;
+		if (item->alias == 1)
+			kas_stats.groups++;
+		if (item->alias > kas_stats.largest_group)
+			kas_stats.largest_group = item->alias;
+	}
+
+	if (index_name && !write_index(index_name, &list, &map)) {
+		fprintf(stderr, "Can't write index file.\n");
+		return 1;
+	}
+
+flush:
+	if (!out_flush(&out)) {
+		fprintf(stderr, "Error writing output file.\n");
+		return 1;
+	}
+	if (!stream)
+		stats_stop(&t, PHASE_OUTPUT);
+
+	/* the file only needs rewriting when this run did not just replay it */
+	stats_start(&t);
+	if (state_name && need_2_process && !use_state && !alias_state_save(&state, state_name)) {
+		fprintf(stderr, "Can't write state file.\n");
+		return 1;
+	}
+	alias_state_free(&state);
+	if (state_name)
+		stats_stop(&t, PHASE_STATE);
+
+	if (stats)
+		stats_print(stderr, stats_json);
+
+	out_free(&out);
+	linker_map_free(&map);
+	alias_filter_free(&filter);
+	if (out_name)
+		close(out_fd);
+	free_items(&list);
+	nm_parser_free(&parser);
+	if (fd)
+		close(fd);
 
 	return 0;
 }
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <string.h>
+
+#include "kas_bin.h"
+#include "item_list.h"
+#include "output.h"
+
+/*
+ * Writes an address sorted list as a binary table: the records first,
+ * aliases numbered as in the text output, then the names in the same
+ * order. Returns 0 if a name or the strings outgrow the record fields.
+ */
+int kas_bin_write(struct output *o, const struct item_list *list)
+{
+	struct kas_bin_header h = {0};
+	struct kas_bin_record r = {0};
+	const struct item *item;
+	uint64_t offset = 0;
+	size_t i, len;
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		len = item->alias ? alias_suffix_size(o->map, item) : 0;
+		if (item->name_len + len > KAS_BIN_NAME_MAX)
+			return 0;
+		h.count += item->alias ? 2 : 1;
+		h.strings_size += item->name_len + 1 + (item->alias ? item->name_len + len + 1 : 0);
+	}
+	if (h.strings_size > UINT32_MAX)
+		return 0;
+
+	memcpy(h.magic, KAS_BIN_MAGIC, sizeof(h.magic));
+	h.version = KAS_BIN_VERSION;
+	h.record_size = sizeof(r);
+	h.strings_offset = sizeof(h) + h.count * sizeof(r);
+	out_write(o, (const char *)&h, sizeof(h));
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		r.addr = item->addr;
+		r.name = offset;
+		r.name_len = item->name_len;
+		r.stype = item->stype;
+		r.flags = 0;
+		out_write(o, (const char *)&r, sizeof(r));
+		offset += item->name_len + 1;
+		if (!item->alias)
+			continue;
+
+		r.name = offset;
+		r.name_len = item->name_len + alias_suffix_size(o->map, item);
+		r.flags = KAS_BIN_ALIAS;
+		out_write(o, (const char *)&r, sizeof(r));
+		offset += r.name_len + 1;
+	}
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		out_write(o, item->symb_name, item->name_len);
+		out_write(o, "", 1);
+		if (!item->alias)
+			continue;
+
+		out_write(o, item->symb_name, item->name_len);
+		out_alias_suffix(o, item);
+		out_write(o, "", 1);
+	}
+	return 1;
+}
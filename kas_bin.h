@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef KAS_BIN_H
+#define KAS_BIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Binary symbol table written with -binary, laid out so that a consumer
+ * such as scripts/kallsyms can mmap it and use it in place:
+ *
+ *	struct kas_bin_header
+ *	struct kas_bin_record[count]	in address order
+ *	strings				NUL terminated names
+ *
+ * An alias is a record of its own, following the symbol it aliases, with
+ * KAS_BIN_ALIAS set and its full name in the strings. Fields are in the
+ * byte order of the host that wrote the file: it is made and consumed by
+ * the same build.
+ */
+#define KAS_BIN_MAGIC "KASALIAS"
+#define KAS_BIN_VERSION 1
+
+#define KAS_BIN_ALIAS 0x01
+
+struct kas_bin_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	record_size;
+	uint64_t	count;
+	uint64_t	strings_offset;
+	uint64_t	strings_size;
+};
+
+struct kas_bin_record {
+	uint64_t	addr;
+	uint32_t	name;		/* offset in the strings */
+	uint16_t	name_len;
+	char		stype;
+	uint8_t		flags;
+};
+
+#define KAS_BIN_NAME_MAX UINT16_MAX
+
+static inline const struct kas_bin_record *kas_bin_records(const struct kas_bin_header *h)
+{
+	return (const struct kas_bin_record *)(h + 1);
+}
+
+static inline const char *kas_bin_name(const struct kas_bin_header *h,
+				       const struct kas_bin_record *r)
+{
+	return (const char *)h + h->strings_offset + r->name;
+}
+
+/*
+ * Returns the header of a mapped table, or NULL if the len bytes at map
+ * are not a complete table of this version. Every name of an accepted
+ * table lies inside it and is NUL terminated.
+ */
+static inline const struct kas_bin_header *kas_bin_check(const void *map, size_t len)
+{
+	const struct kas_bin_header *h = map;
+	const struct kas_bin_record *r;
+	const char *strings;
+	uint64_t i;
+
+	if (len < sizeof(*h) || memcmp(h->magic, KAS_BIN_MAGIC, sizeof(h->magic)) ||
+	    h->version != KAS_BIN_VERSION || h->record_size != sizeof(*r))
+		return NULL;
+	if (h->count > (len - sizeof(*h)) / sizeof(*r) ||
+	    h->strings_offset != sizeof(*h) + h->count * sizeof(*r) ||
+	    h->strings_size > len - h->strings_offset)
+		return NULL;
+
+	strings = (const char *)map + h->strings_offset;
+	for (i = 0, r = kas_bin_records(h); i < h->count; i++, r++)
+		if (r->name >= h->strings_size || h->strings_size - r->name <= r->name_len ||
+		    strings[r->name + r->name_len] != '\0')
+			return NULL;
+	return h;
+}
+
+struct output;
+struct item_list;
+
+int kas_bin_write(struct output *o, const struct item_list *list);
+#endif
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kas_index.h"
+#include "item_list.h"
+#include "duplicates_list.h"
+#include "output.h"
+#include "alloc.h"
+
+static int by_alias(const void *a, const void *b)
+{
+	const struct item *x = *(const struct item *const *)a;
+	const struct item *y = *(const struct item *const *)b;
+
+	return (x->alias > y->alias) - (x->alias < y->alias);
+}
+
+/*
+ * Items of the list by group and ordinal, with the groups in name order.
+ * A filter may have taken some aliases out of a group, so its ordinals
+ * need not run from 1 to its size; the survivors keep their own. Returns
+ * the array, NULL if memory ran out or an ordinal repeats in a group.
+ */
+static const struct item **order_entries(const struct item_list *list, struct dup_table *table,
+					 struct item_list *groups, size_t aliased)
+{
+	const struct item **entries;
+	struct dup_entry *entry;
+	const struct item *item;
+	size_t i, j, start;
+
+	entries = kas_calloc(aliased ? aliased : 1, sizeof(*entries));
+	if (!entries)
+		return NULL;
+
+	/* count refills as the items are placed */
+	for (i = 0, start = 0; i < groups->count; i++) {
+		item = &groups->items[i];
+		entry = dup_table_find(table, item->symb_name, item->name_len, item->hash);
+		entry->first = start;
+		start += entry->count;
+		entry->count = 0;
+	}
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (!item->alias)
+			continue;
+		entry = dup_table_find(table, item->symb_name, item->name_len, item->hash);
+		entries[entry->first + entry->count++] = item;
+	}
+
+	for (i = 0; i < groups->count; i++) {
+		item = &groups->items[i];
+		entry = dup_table_find(table, item->symb_name, item->name_len, item->hash);
+		qsort(entries + entry->first, entry->count, sizeof(*entries), by_alias);
+		for (j = entry->first + 1; j < entry->first + entry->count; j++) {
+			if (entries[j]->alias == entries[j - 1]->alias) {
+				kas_free(entries);
+				return NULL;
+			}
+		}
+	}
+	return entries;
+}
+
+/*
+ * Writes the index of the aliased items of list. The groups are sorted
+ * with the name radix sort on a list holding one item per group. Returns
+ * 0 if memory ran out or the strings outgrow an offset.
+ */
+int kas_index_write(struct output *o, const struct item_list *list)
+{
+	struct kas_index_header h = {0};
+	struct kas_index_group g = {0};
+	struct kas_bin_record e = {0};
+	struct item_list groups = {0};
+	const struct item **entries;
+	const struct item *item;
+	struct dup_entry *entry;
+	struct dup_table table;
+	size_t i, aliased = 0;
+	uint64_t offset = 0;
+	int ret = 0;
+
+	for (i = 0; i < list->count; i++)
+		aliased += list->items[i].alias != 0;
+	if (!dup_table_init(&table, aliased))
+		return 0;
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (!item->alias)
+			continue;
+		entry = dup_table_insert(&table, item->symb_name, item->name_len, item->hash);
+		if (!entry)
+			goto out;
+		if (!entry->count++ &&
+		    !add_item_ref(&groups, item->symb_name, item->name_len, item->stype, item->addr))
+			goto out;
+	}
+	if (!sort_list_m(&groups, BY_NAME))
+		goto out;
+
+	entries = order_entries(list, &table, &groups, aliased);
+	if (!entries)
+		goto out;
+
+	memcpy(h.magic, KAS_INDEX_MAGIC, sizeof(h.magic));
+	h.version = KAS_INDEX_VERSION;
+	h.group_size = sizeof(g);
+	h.entry_size = sizeof(e);
+	h.ngroups = groups.count;
+	h.nentries = aliased;
+	h.strings_offset = sizeof(h) + h.ngroups * sizeof(g) + h.nentries * sizeof(e);
+	for (i = 0; i < groups.count; i++)
+		h.strings_size += groups.items[i].name_len + 1;
+	for (i = 0; i < aliased; i++) {
+		if (entries[i]->name_len + alias_suffix_size(o->map, entries[i]) > KAS_BIN_NAME_MAX)
+			goto out_entries;
+		h.strings_size += entries[i]->name_len + alias_suffix_size(o->map, entries[i]) + 1;
+	}
+	if (h.strings_size > UINT32_MAX)
+		goto out_entries;
+
+	out_write(o, (const char *)&h, sizeof(h));
+
+	for (i = 0; i < groups.count; i++) {
+		item = &groups.items[i];
+		entry = dup_table_find(&table, item->symb_name, item->name_len, item->hash);
+		g.name = offset;
+		g.name_len = item->name_len;
+		g.first = entry->first;
+		g.count = entry->count;
+		out_write(o, (const char *)&g, sizeof(g));
+		offset += item->name_len + 1;
+	}
+
+	for (i = 0; i < aliased; i++) {
+		item = entries[i];
+		e.addr = item->addr;
+		e.name = offset;
+		e.name_len = item->name_len + alias_suffix_size(o->map, item);
+		e.stype = item->stype;
+		e.flags = KAS_BIN_ALIAS;
+		out_write(o, (const char *)&e, sizeof(e));
+		offset += e.name_len + 1;
+	}
+
+	for (i = 0; i < groups.count; i++) {
+		out_write(o, groups.items[i].symb_name, groups.items[i].name_len);
+		out_write(o, "", 1);
+	}
+	for (i = 0; i < aliased; i++) {
+		out_write(o, entries[i]->symb_name, entries[i]->name_len);
+		out_alias_suffix(o, entries[i]);
+		out_write(o, "", 1);
+	}
+	ret = 1;
+
+out_entries:
+	kas_free(entries);
+out:
+	free_items(&groups);
+	dup_table_free(&table);
+	return ret;
+}
@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef KAS_INDEX_H
+#define KAS_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "kas_bin.h"
+
+/*
+ * Index of the duplicate names, written with -index, for tools that turn
+ * an ambiguous name into the aliases to probe. It is meant to be mmapped:
+ *
+ *	struct kas_index_header
+ *	struct kas_index_group[ngroups]	sorted by name, in strcmp() order
+ *	struct kas_bin_record[nentries]	each group's symbols, by address
+ *	strings				NUL terminated names
+ *
+ * A group names its symbols as entries [first, first + count); an entry
+ * carries the symbol's address and type and the name of its alias. As
+ * for kas_bin.h, fields are in the byte order of the writing host.
+ */
+#define KAS_INDEX_MAGIC "KASINDEX"
+#define KAS_INDEX_VERSION 1
+
+struct kas_index_header {
+	char		magic[8];
+	uint32_t	version;
+	uint16_t	group_size;
+	uint16_t	entry_size;
+	uint64_t	ngroups;
+	uint64_t	nentries;
+	uint64_t	strings_offset;
+	uint64_t	strings_size;
+};
+
+struct kas_index_group {
+	uint32_t	name;		/* offset in the strings */
+	uint32_t	name_len;
+	uint32_t	first;
+	uint32_t	count;
+};
+
+static inline const struct kas_index_group *kas_index_groups(const struct kas_index_header *h)
+{
+	return (const struct kas_index_group *)(h + 1);
+}
+
+static inline const struct kas_bin_record *kas_index_entries(const struct kas_index_header *h)
+{
+	return (const struct kas_bin_record *)(kas_index_groups(h) + h->ngroups);
+}
+
+static inline const char *kas_index_string(const struct kas_index_header *h, uint32_t offset)
+{
+	return (const char *)h + h->strings_offset + offset;
+}
+
+/*
+ * Returns the header of a mapped index, or NULL if the len bytes at map
+ * are not a complete index of this version. In an accepted index every
+ * group's entries and every name lie inside the file.
+ */
+static inline const struct kas_index_header *kas_index_check(const void *map, size_t len)
+{
+	const struct kas_index_header *h = map;
+	const struct kas_index_group *g;
+	const struct kas_bin_record *e;
+	const char *strings;
+	uint64_t i, end;
+
+	if (len < sizeof(*h) || memcmp(h->magic, KAS_INDEX_MAGIC, sizeof(h->magic)) ||
+	    h->version != KAS_INDEX_VERSION || h->group_size != sizeof(*g) ||
+	    h->entry_size != sizeof(*e))
+		return NULL;
+	if (h->ngroups > (len - sizeof(*h)) / sizeof(*g) ||
+	    h->nentries > (len - sizeof(*h) - h->ngroups * sizeof(*g)) / sizeof(*e))
+		return NULL;
+	end = sizeof(*h) + h->ngroups * sizeof(*g) + h->nentries * sizeof(*e);
+	if (h->strings_offset != end || h->strings_size > len - end)
+		return NULL;
+
+	strings = (const char *)map + end;
+	for (i = 0, g = kas_index_groups(h); i < h->ngroups; i++, g++)
+		if (g->first > h->nentries || g->count > h->nentries - g->first ||
+		    g->name >= h->strings_size || h->strings_size - g->name <= g->name_len ||
+		    strings[g->name + g->name_len] != '\0')
+			return NULL;
+	for (i = 0, e = kas_index_entries(h); i < h->nentries; i++, e++)
+		if (e->name >= h->strings_size || h->strings_size - e->name <= e->name_len ||
+		    strings[e->name + e->name_len] != '\0')
+			return NULL;
+	return h;
+}
+
+/* Binary search for the group of a duplicate name; NULL if it is unique. */
+static inline const struct kas_index_group *kas_index_find(const struct kas_index_header *h,
+							   const char *name, size_t len)
+{
+	const struct kas_index_group *groups = kas_index_groups(h), *g;
+	size_t lo = 0, hi = h->ngroups, mid, n;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		g = &groups[mid];
+		n = len < g->name_len ? len : g->name_len;
+		cmp = memcmp(name, kas_index_string(h, g->name), n);
+		if (!cmp)
+			cmp = (len > g->name_len) - (len < g->name_len);
+		if (!cmp)
+			return g;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+struct output;
+struct item_list;
+
+int kas_index_write(struct output *o, const struct item_list *list);
+#endif
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Resolves probe specs against a table written with kas_alias -binary,
+ * through libkasalias. Each query prints the matching records as nm
+ * lines:
+ *
+ *	name		the symbols and aliases of that name
+ *	glob		names matching a shell pattern (with * ? or [)
+ *	/regex/		names matching a POSIX extended regex
+ *	0xaddr		the records at an address
+ *	name:0xaddr	the alias of name at an address
+ *	-		the queries in stdin, one per line
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "kas_table.h"
+#include "output.h"
+
+static int print_record(const struct kas_table *t, const struct kas_bin_record *r, void *arg)
+{
+	out_symbol(arg, r->addr, r->stype, kas_table_name(t, r), r->name_len, "", 0);
+	return 0;
+}
+
+static bool parse_addr(const char *s, uint64_t *addr)
+{
+	char *end;
+
+	if (strncmp(s, "0x", 2) != 0 || !s[2])
+		return false;
+	*addr = strtoull(s + 2, &end, 16);
+	return !*end;
+}
+
+/* Returns the number of records printed, -1 for a regex that does not compile. */
+static long query(const struct kas_table *t, struct output *out, const char *q, size_t len)
+{
+	const struct kas_bin_record *r;
+	const char *colon;
+	size_t i, n, first;
+	uint64_t addr;
+	char *s;
+	long ret;
+
+	s = strndup(q, len);
+	if (!s)
+		return -1;
+
+	colon = strrchr(s, ':');
+	if (len > 2 && s[0] == '/' && s[len - 1] == '/') {
+		s[len - 1] = '\0';
+		ret = kas_table_regex(t, s + 1, print_record, out);
+	} else if (strpbrk(s, "*?[")) {
+		ret = kas_table_glob(t, s, print_record, out);
+	} else if (parse_addr(s, &addr)) {
+		r = kas_table_at(t, addr, &n);
+		for (i = 0; i < n; i++)
+			print_record(t, &r[i], out);
+		ret = n;
+	} else if (colon && parse_addr(colon + 1, &addr)) {
+		r = kas_table_alias(t, s, colon - s, addr);
+		if (r)
+			print_record(t, r, out);
+		ret = r != NULL;
+	} else {
+		n = kas_table_lookup(t, s, len, &first);
+		for (i = 0; i < n; i++)
+			print_record(t, kas_table_by_name(t, first + i), out);
+		ret = n;
+	}
+
+	free(s);
+	return ret;
+}
+
+static int query_stdin(const struct kas_table *t, struct output *out)
+{
+	size_t cap = 0;
+	char *line = NULL;
+	ssize_t len;
+	int ret = 0;
+
+	while ((len = getline(&line, &cap, stdin)) > 0) {
+		if (line[len - 1] == '\n')
+			len--;
+		if (len && query(t, out, line, len) < 0)
+			ret = 1;
+	}
+	free(line);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct kas_table table;
+	struct output out;
+	int i, ret = 0;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <binary table> <query>...\n", argv[0]);
+		return 1;
+	}
+
+	ret = kas_table_open(&table, argv[1]);
+	if (ret <= 0) {
+		fprintf(stderr, ret ? "Can't read symbol table.\n" : "Error in allocate memory\n");
+		return 1;
+	}
+	if (!out_init(&out, 1)) {
+		fprintf(stderr, "Error in allocate memory\n");
+		return 1;
+	}
+
+	ret = 0;
+	for (i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-") == 0) {
+			ret |= query_stdin(&table, &out);
+		} else if (query(&table, &out, argv[i], strlen(argv[i])) < 0) {
+			fprintf(stderr, "Bad query %s\n", argv[i]);
+			ret = 1;
+		}
+	}
+
+	if (!out_flush(&out)) {
+		fprintf(stderr, "Error writing output file.\n");
+		ret = 1;
+	}
+	out_free(&out);
+	kas_table_close(&table);
+	return ret;
+}
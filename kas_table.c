@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "kas_table.h"
+#include "item_list.h"
+#include "alloc.h"
+
+/*
+ * Orders the records by name with the name radix sort. The record index
+ * stands in for the address of each item: the sort is stable, so records
+ * of one name stay in index order, which is address order.
+ */
+static int index_names(struct kas_table *t)
+{
+	struct item_list list = {0};
+	const struct kas_bin_record *r;
+	size_t i;
+
+	if (!item_list_reserve(&list, t->count))
+		return 0;
+	for (i = 0; i < t->count; i++) {
+		r = &t->records[i];
+		add_item_ref(&list, kas_bin_name(t->h, r), r->name_len, r->stype, i);
+	}
+	if (!sort_list_m(&list, BY_NAME)) {
+		free_items(&list);
+		return 0;
+	}
+
+	t->by_name = kas_malloc((t->count ? t->count : 1) * sizeof(*t->by_name));
+	if (t->by_name)
+		for (i = 0; i < t->count; i++)
+			t->by_name[i] = list.items[i].addr;
+
+	free_items(&list);
+	return t->by_name != NULL;
+}
+
+/*
+ * Maps the table at path and indexes it. Returns 1 on success, 0 if
+ * memory ran out and -1 if the file cannot be read or is not a table of
+ * this version.
+ */
+int kas_table_open(struct kas_table *t, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(t, 0, sizeof(*t));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size) {
+		close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return errno == ENOMEM ? 0 : -1;
+
+	t->map = map;
+	t->len = st.st_size;
+	t->h = kas_bin_check(map, st.st_size);
+	if (!t->h || t->h->count > UINT32_MAX) {
+		kas_table_close(t);
+		return -1;
+	}
+	t->records = kas_bin_records(t->h);
+	t->count = t->h->count;
+
+	if (!index_names(t)) {
+		kas_table_close(t);
+		return 0;
+	}
+	return 1;
+}
+
+/* The records at addr, a symbol followed by its aliases; NULL if none. */
+const struct kas_bin_record *kas_table_at(const struct kas_table *t, uint64_t addr,
+					  size_t *count)
+{
+	size_t lo = 0, hi = t->count, mid, end;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (t->records[mid].addr < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (end = lo; end < t->count && t->records[end].addr == addr; end++)
+		;
+
+	*count = end - lo;
+	return end > lo ? &t->records[lo] : NULL;
+}
+
+/*
+ * strcmp() order of a record's name against key. With prefix set, names
+ * that start with key compare equal to it.
+ */
+static int name_cmp(const struct kas_table *t, size_t pos, const char *key, size_t len,
+		    bool prefix)
+{
+	const struct kas_bin_record *r = kas_table_by_name(t, pos);
+	size_t n = r->name_len < len ? r->name_len : len;
+	int cmp;
+
+	cmp = memcmp(kas_table_name(t, r), key, n);
+	if (cmp || (prefix && r->name_len >= len))
+		return cmp;
+	return (r->name_len > len) - (r->name_len < len);
+}
+
+/* First name position comparing above key, or at or above it unless upper. */
+static size_t bound(const struct kas_table *t, const char *key, size_t len, bool prefix,
+		    bool upper)
+{
+	size_t lo = 0, hi = t->count, mid;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = name_cmp(t, mid, key, len, prefix);
+		if (cmp < 0 || (upper && !cmp))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Records named name, by address, as name positions [*first, *first + count). */
+size_t kas_table_lookup(const struct kas_table *t, const char *name, size_t len,
+			size_t *first)
+{
+	*first = bound(t, name, len, false, false);
+	return bound(t, name, len, false, true) - *first;
+}
+
+/* Records whose name starts with prefix, in name order. */
+size_t kas_table_prefix(const struct kas_table *t, const char *prefix, size_t len,
+			size_t *first)
+{
+	*first = bound(t, prefix, len, true, false);
+	return bound(t, prefix, len, true, true) - *first;
+}
+
+/*
+ * The alias of the symbol name at addr, numbered or named after its
+ * object file; NULL if that symbol has none.
+ */
+const struct kas_bin_record *kas_table_alias(const struct kas_table *t, const char *name,
+					     size_t len, uint64_t addr)
+{
+	const struct kas_bin_record *r;
+	const char *s;
+	size_t i, n;
+
+	r = kas_table_at(t, addr, &n);
+	for (i = 0; i < n; i++, r++) {
+		if (!(r->flags & KAS_BIN_ALIAS) || r->name_len <= len)
+			continue;
+		s = kas_table_name(t, r);
+		if (memcmp(s, name, len) == 0 &&
+		    (s[len] == '@' || strncmp(s + len, "__alias__", 9) == 0))
+			return r;
+	}
+	return NULL;
+}
+
+/* Runs fn on the matches among name positions [first, end). */
+static size_t match_range(const struct kas_table *t, size_t first, size_t end,
+			  bool (*match)(const char *name, const void *pattern),
+			  const void *pattern, kas_table_fn fn, void *arg)
+{
+	const struct kas_bin_record *r;
+	size_t i, found = 0;
+
+	for (i = first; i < end; i++) {
+		r = kas_table_by_name(t, i);
+		if (!match(kas_table_name(t, r), pattern))
+			continue;
+		found++;
+		if (fn && fn(t, r, arg))
+			break;
+	}
+	return found;
+}
+
+static bool glob_match(const char *name, const void *pattern)
+{
+	return fnmatch(pattern, name, 0) == 0;
+}
+
+/*
+ * Records whose name matches the shell pattern, in name order. The
+ * literal head of the pattern narrows the search to a prefix range, so
+ * "__x64_sys_*" only looks at the system calls. Returns the number of
+ * matches handed to fn.
+ */
+size_t kas_table_glob(const struct kas_table *t, const char *pattern, kas_table_fn fn,
+		      void *arg)
+{
+	size_t first, n;
+
+	n = kas_table_prefix(t, pattern, strcspn(pattern, "*?[\\"), &first);
+	return match_range(t, first, first + n, glob_match, pattern, fn, arg);
+}
+
+static bool regex_match(const char *name, const void *re)
+{
+	return regexec(re, name, 0, NULL, 0) == 0;
+}
+
+/*
+ * Length of the literal every match of an extended regex starts with:
+ * the plain characters after a leading '^', less one that a following
+ * '*', '?' or '{' makes optional. 0 if the regex is not anchored or has
+ * an alternation.
+ */
+static size_t regex_head(const char *regex)
+{
+	size_t n;
+
+	if (regex[0] != '^' || strchr(regex, '|'))
+		return 0;
+	n = strcspn(regex + 1, ".[]()*+?{}|\\^$");
+	if (n && regex[1 + n] && strchr("*?{", regex[1 + n]))
+		n--;
+	return n;
+}
+
+/*
+ * Records whose name matches the POSIX extended regex, in name order;
+ * an anchored literal head narrows the search like a glob's. Returns the
+ * number of matches handed to fn, -1 if the regex does not compile.
+ */
+long kas_table_regex(const struct kas_table *t, const char *regex, kas_table_fn fn,
+		     void *arg)
+{
+	size_t first, n, found;
+	regex_t re;
+
+	if (regcomp(&re, regex, REG_EXTENDED | REG_NOSUB))
+		return -1;
+
+	n = regex_head(regex);
+	if (n) {
+		n = kas_table_prefix(t, regex + 1, n, &first);
+	} else {
+		first = 0;
+		n = t->count;
+	}
+	found = match_range(t, first, first + n, regex_match, &re, fn, arg);
+
+	regfree(&re);
+	return found;
+}
+
+void kas_table_close(struct kas_table *t)
+{
+	if (t->map)
+		munmap(t->map, t->len);
+	kas_free(t->by_name);
+	memset(t, 0, sizeof(*t));
+}
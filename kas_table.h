@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef KAS_TABLE_H
+#define KAS_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "kas_bin.h"
+
+/*
+ * Queries on a table written with -binary, for tracing frontends that
+ * resolve probe specs: the file is mapped once and validated, and an
+ * index of its records in name order is built next to the address
+ * ordered records. Symbols and aliases are records alike, so a name
+ * query finds "foo" and "foo__alias__2" by their own names; the
+ * aliases of a symbol are the alias records at its address.
+ *
+ * Name positions returned by the lookups index by_name, in strcmp()
+ * order of the names and, within a name, in address order.
+ */
+struct kas_table {
+	const struct kas_bin_header	*h;
+	const struct kas_bin_record	*records;
+	size_t				count;
+	uint32_t			*by_name;	/* record indices */
+	void				*map;
+	size_t				len;
+};
+
+/* Called for each match; a nonzero return stops the query. */
+typedef int (*kas_table_fn)(const struct kas_table *t, const struct kas_bin_record *r,
+			    void *arg);
+
+int kas_table_open(struct kas_table *t, const char *path);
+const struct kas_bin_record *kas_table_at(const struct kas_table *t, uint64_t addr,
+					  size_t *count);
+size_t kas_table_lookup(const struct kas_table *t, const char *name, size_t len,
+			size_t *first);
+size_t kas_table_prefix(const struct kas_table *t, const char *prefix, size_t len,
+			size_t *first);
+const struct kas_bin_record *kas_table_alias(const struct kas_table *t, const char *name,
+					     size_t len, uint64_t addr);
+size_t kas_table_glob(const struct kas_table *t, const char *pattern, kas_table_fn fn,
+		      void *arg);
+long kas_table_regex(const struct kas_table *t, const char *regex, kas_table_fn fn,
+		     void *arg);
+void kas_table_close(struct kas_table *t);
+
+static inline const struct kas_bin_record *kas_table_by_name(const struct kas_table *t,
+							     size_t pos)
+{
+	return &t->records[t->by_name[pos]];
+}
+
+static inline const char *kas_table_name(const struct kas_table *t,
+					 const struct kas_bin_record *r)
+{
+	return kas_bin_name(t->h, r);
+}
+#endif
@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "linker_map.h"
+#include "alloc.h"
+#include "stats.h"
+
+/* Input sections listed before this line were discarded by the link. */
+#define MAP_START "Linker script and memory map"
+
+static inline bool is_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skip_blanks(const char *p, const char *end)
+{
+	while (p < end && is_blank(*p))
+		p++;
+	return p;
+}
+
+static const char *token_end(const char *p, const char *end)
+{
+	while (p < end && !is_blank(*p))
+		p++;
+	return p;
+}
+
+/* Reads a "0x<hex>" token at *p; false if there is none. */
+static bool parse_hex(const char **p, const char *end, uint64_t *v)
+{
+	const char *s = *p;
+	unsigned int d;
+
+	if (end - s < 3 || s[0] != '0' || s[1] != 'x')
+		return false;
+
+	for (s += 2, *v = 0; s < end && !is_blank(*s); s++) {
+		if (*s >= '0' && *s <= '9')
+			d = *s - '0';
+		else if ((*s | 0x20) >= 'a' && (*s | 0x20) <= 'f')
+			d = (*s | 0x20) - 'a' + 10;
+		else
+			return false;
+		*v = *v << 4 | d;
+	}
+	*p = s;
+	return true;
+}
+
+static int intern_file(struct linker_map *m, const char *name, size_t len, uint32_t *index)
+{
+	struct dup_entry *entry;
+	struct map_file *files;
+	size_t cap;
+
+	entry = dup_table_insert(&m->names, name, len, name_hash(name, len));
+	if (!entry)
+		return 0;
+
+	if (!entry->count++) {
+		if (m->nfiles == m->files_cap) {
+			cap = m->files_cap ? m->files_cap * 2 : 1024;
+			files = kas_realloc(m->files, m->files_cap * sizeof(*files),
+					    cap * sizeof(*files));
+			if (!files)
+				return 0;
+			m->files = files;
+			m->files_cap = cap;
+		}
+		m->files[m->nfiles].name = name;
+		m->files[m->nfiles].name_len = len;
+		entry->first = m->nfiles++;
+	}
+	*index = entry->first;
+	return 1;
+}
+
+static int add_object(struct linker_map *m, uint64_t addr, uint64_t size,
+		      const char *file, size_t file_len)
+{
+	struct map_object *objects;
+	size_t cap;
+
+	if (m->count == m->cap) {
+		cap = m->cap ? m->cap * 2 : 4096;
+		objects = kas_realloc(m->objects, m->cap * sizeof(*objects),
+				      cap * sizeof(*objects));
+		if (!objects)
+			return 0;
+		m->objects = objects;
+		m->cap = cap;
+	}
+
+	m->objects[m->count].addr = addr;
+	m->objects[m->count].size = size;
+	if (!intern_file(m, file, file_len, &m->objects[m->count].file))
+		return 0;
+	m->count++;
+	return 1;
+}
+
+/*
+ * Scans the map once, line by line, for input section lines:
+ *
+ *	 .text          0xffffffff81000670      0x8ef init/main.o
+ *
+ * ld puts the address on a line of its own when the section name is
+ * long; the name is remembered until then. Output sections start in the
+ * first column, and fill, patterns, symbols and assignments either start
+ * with '*' or carry a single number, so none of them is taken. Empty,
+ * unallocated (address 0) and debug sections are left out, as they
+ * place no symbol.
+ */
+static int scan_map(struct linker_map *m)
+{
+	const char *line, *nl, *p, *tok, *end = m->buf + m->len;
+	bool started = false, pending = false, keep = false;
+	uint64_t addr, size;
+
+	for (line = m->buf; line < end; line = nl + 1) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+
+		if (!started) {
+			started = (size_t)(nl - line) >= sizeof(MAP_START) - 1 &&
+				  memcmp(line, MAP_START, sizeof(MAP_START) - 1) == 0;
+			continue;
+		}
+
+		p = skip_blanks(line, nl);
+		if (p == nl || *p == '*') {
+			pending = false;
+			continue;
+		}
+
+		if (!(p[0] == '0' && p + 1 < nl && p[1] == 'x')) {
+			/* a section name: input sections are indented */
+			tok = token_end(p, nl);
+			keep = p != line && !(tok - p >= 6 && memcmp(p, ".debug", 6) == 0);
+			p = skip_blanks(tok, nl);
+			pending = p == nl;
+			if (pending || !keep)
+				continue;
+		} else if (!pending) {
+			continue;
+		}
+		pending = false;
+
+		if (!parse_hex(&p, nl, &addr))
+			continue;
+		p = skip_blanks(p, nl);
+		if (!parse_hex(&p, nl, &size))
+			continue;
+		p = skip_blanks(p, nl);
+		for (tok = nl; tok > p && is_blank(tok[-1]); tok--)
+			;
+		if (!keep || tok == p || !addr || !size || size > UINT32_MAX)
+			continue;
+
+		if (!add_object(m, addr, size, p, tok - p))
+			return 0;
+	}
+	return 1;
+}
+
+static int object_cmp(const void *a, const void *b)
+{
+	const struct map_object *x = a, *y = b;
+
+	return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/* ld lists each output section in address order, so this rarely sorts. */
+static void sort_objects(struct linker_map *m)
+{
+	size_t i;
+
+	for (i = 1; i < m->count; i++)
+		if (m->objects[i].addr < m->objects[i - 1].addr)
+			break;
+	if (i < m->count)
+		qsort(m->objects, m->count, sizeof(*m->objects), object_cmp);
+}
+
+/*
+ * Maps the file and indexes its input sections. Returns 1 on success, 0
+ * if memory ran out and -1 if the file cannot be read.
+ */
+int linker_map_load(struct linker_map *m, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(m, 0, sizeof(*m));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return -1;
+	}
+	if (!st.st_size) {
+		close(fd);
+		return dup_table_init(&m->names, 0);
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return errno == ENOMEM ? 0 : -1;
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	kas_stats.input_bytes += st.st_size;
+	m->buf = map;
+	m->len = st.st_size;
+
+	if (!dup_table_init(&m->names, 0) || !scan_map(m)) {
+		linker_map_free(m);
+		return 0;
+	}
+	sort_objects(m);
+	return 1;
+}
+
+/* Index of the last section starting at or below addr, m->count if none. */
+static size_t last_at_or_below(const struct linker_map *m, uint64_t addr)
+{
+	size_t lo = 0, hi = m->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (m->objects[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo ? lo - 1 : m->count;
+}
+
+static const struct map_file *object_file(const struct linker_map *m, size_t i,
+					  uint64_t addr)
+{
+	const struct map_object *o = &m->objects[i];
+
+	if (i == m->count || addr - o->addr >= o->size)
+		return NULL;
+	return &m->files[o->file];
+}
+
+/* The object whose section holds addr, NULL if none does. */
+const struct map_file *linker_map_find(const struct linker_map *m, uint64_t addr)
+{
+	return object_file(m, last_at_or_below(m, addr), addr);
+}
+
+void map_cursor_init(struct map_cursor *c, const struct linker_map *m)
+{
+	c->map = m;
+	c->pos = 0;
+}
+
+/*
+ * Same answer as linker_map_find(). An address below the previous one
+ * starts over with a binary search.
+ */
+const struct map_file *map_cursor_find(struct map_cursor *c, uint64_t addr)
+{
+	const struct linker_map *m = c->map;
+
+	if (!m->count)
+		return NULL;
+	if (addr < m->objects[c->pos].addr) {
+		c->pos = last_at_or_below(m, addr);
+		if (c->pos == m->count) {
+			c->pos = 0;
+			return NULL;
+		}
+	}
+	while (c->pos + 1 < m->count && m->objects[c->pos + 1].addr <= addr)
+		c->pos++;
+	return object_file(m, c->pos, addr);
+}
+
+#define OBJ_CLASH (1u << 31)
+
+/*
+ * Points every aliased item of an address sorted list at the object
+ * file its address falls in, one merge of the list with the sections.
+ * Symbols of one name that share an object, or whose object is unknown,
+ * keep their numbered alias: a second pass chains the items of each name
+ * and compares their objects. Returns 0 if memory ran out.
+ */
+int linker_map_name_aliases(const struct linker_map *m, struct item_list *list)
+{
+	const struct map_file *file;
+	struct map_cursor cursor;
+	struct dup_entry *entry;
+	struct dup_table table;
+	struct item *item;
+	uint32_t *prev, j;
+	size_t i, aliased = 0;
+
+	map_cursor_init(&cursor, m);
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (!item->alias)
+			continue;
+		file = map_cursor_find(&cursor, item->addr);
+		item->obj = file ? file - m->files + 1 : 0;
+		aliased++;
+	}
+	if (!aliased)
+		return 1;
+
+	prev = kas_malloc(list->count * sizeof(uint32_t));
+	if (!prev || !dup_table_init(&table, aliased)) {
+		kas_free(prev);
+		return 0;
+	}
+
+	for (i = 0; i < list->count; i++) {
+		item = &list->items[i];
+		if (!item->alias)
+			continue;
+		entry = dup_table_insert(&table, item->symb_name, item->name_len, item->hash);
+		if (!entry) {
+			kas_free(prev);
+			dup_table_free(&table);
+			return 0;
+		}
+
+		/* entry->first is the latest item of the name, plus one */
+		prev[i] = entry->count++ ? entry->first : 0;
+		entry->first = i + 1;
+		for (j = prev[i]; j && item->obj; j = prev[j - 1]) {
+			if ((list->items[j - 1].obj & ~OBJ_CLASH) == (item->obj & ~OBJ_CLASH)) {
+				list->items[j - 1].obj |= OBJ_CLASH;
+				item->obj |= OBJ_CLASH;
+			}
+		}
+	}
+
+	for (i = 0; i < list->count; i++)
+		if (list->items[i].obj & OBJ_CLASH)
+			list->items[i].obj = 0;
+
+	kas_free(prev);
+	dup_table_free(&table);
+	return 1;
+}
+
+void linker_map_free(struct linker_map *m)
+{
+	if (m->buf)
+		munmap((void *)m->buf, m->len);
+	kas_free(m->objects);
+	kas_free(m->files);
+	dup_table_free(&m->names);
+	memset(m, 0, sizeof(*m));
+}
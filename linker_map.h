@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef LINKER_MAP_H
+#define LINKER_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "duplicates_list.h"
+
+/* An object file named in the map; name points into the mapped file. */
+struct map_file {
+	const char	*name;
+	uint32_t	name_len;
+};
+
+/* One input section: [addr, addr + size) came from files[file]. */
+struct map_object {
+	uint64_t	addr;
+	uint32_t	size;
+	uint32_t	file;
+};
+
+/*
+ * The input sections of a GNU ld map (-Map, vmlinux.map), sorted by
+ * address, with the object file names interned.
+ */
+struct linker_map {
+	const char		*buf;
+	size_t			len;
+	struct map_object	*objects;
+	size_t			count;
+	size_t			cap;
+	struct map_file		*files;
+	size_t			nfiles;
+	size_t			files_cap;
+	struct dup_table	names;
+};
+
+/*
+ * Resolves a run of addresses against a map. Lookups in ascending
+ * address order, as for an address sorted symbol list, move forward
+ * through the sections, so resolving a whole list is one merge pass.
+ */
+struct map_cursor {
+	const struct linker_map	*map;
+	size_t			pos;
+};
+
+int linker_map_load(struct linker_map *m, const char *path);
+const struct map_file *linker_map_find(const struct linker_map *m, uint64_t addr);
+void map_cursor_init(struct map_cursor *c, const struct linker_map *m);
+const struct map_file *map_cursor_find(struct map_cursor *c, uint64_t addr);
+int linker_map_name_aliases(const struct linker_map *m, struct item_list *list);
+void linker_map_free(struct linker_map *m);
+#endif
@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "multi_input.h"
+#include "elf_symtab.h"
+#include "output.h"
+#include "parallel.h"
+#include "alloc.h"
+
+struct multi_job {
+	struct multi_run	*run;
+};
+
+static char *copy_string(const char *s, size_t len)
+{
+	char *p = kas_malloc(len + 1);
+
+	if (p) {
+		memcpy(p, s, len);
+		p[len] = '\0';
+	}
+	return p;
+}
+
+static int add_input(struct multi_run *r, const char *in, const char *out)
+{
+	struct multi_input *tmp, *input;
+
+	if (r->count == r->cap) {
+		tmp = kas_realloc(r->inputs, r->cap * sizeof(*tmp),
+				  (r->cap ? r->cap * 2 : 64) * sizeof(*tmp));
+		if (!tmp)
+			return 0;
+		r->inputs = tmp;
+		r->cap = r->cap ? r->cap * 2 : 64;
+	}
+
+	input = &r->inputs[r->count];
+	memset(input, 0, sizeof(*input));
+	input->in_path = copy_string(in, strlen(in));
+	input->out_path = copy_string(out, strlen(out));
+	r->count++;
+	return input->in_path && input->out_path;
+}
+
+/* Reads the list of inputs; blank lines and lines starting with '#' are skipped. */
+int multi_load(struct multi_run *r, const char *path)
+{
+	const char *sep = " \t\r\n";
+	char *line = NULL, *in, *out, *save;
+	size_t cap = 0;
+	int ret = 1;
+	FILE *fp;
+
+	memset(r, 0, sizeof(*r));
+	r->bad = path;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return MULTI_EREAD;
+
+	while (ret > 0 && getline(&line, &cap, fp) > 0) {
+		in = strtok_r(line, sep, &save);
+		if (!in || *in == '#')
+			continue;
+		out = strtok_r(NULL, sep, &save);
+		if (!out || strtok_r(NULL, sep, &save))
+			ret = MULTI_EREAD;
+		else if (!add_input(r, in, out))
+			ret = 0;
+	}
+	if (ret > 0 && ferror(fp))
+		ret = MULTI_EREAD;
+
+	free(line);
+	fclose(fp);
+	return ret;
+}
+
+static int write_processed(struct multi_input *in)
+{
+	struct output out;
+	int fd, ret;
+
+	fd = open(in->out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return MULTI_EWRITE;
+	if (!out_init(&out, fd)) {
+		close(fd);
+		return 0;
+	}
+
+	ret = out_pass_through(&out, &in->parser) < 0 ? MULTI_EREAD : 1;
+	if (!out_flush(&out) && ret > 0)
+		ret = MULTI_EWRITE;
+	out_free(&out);
+	if (close(fd) && ret > 0)
+		ret = MULTI_EWRITE;
+	return ret;
+}
+
+/*
+ * Reads one input into its own list, in address order. An input that
+ * kas_alias processed already is passed through to its output right away
+ * and takes no part in the aliasing.
+ */
+static int parse_one(struct multi_input *in)
+{
+	struct elf_symtab symtab;
+	struct nm_record rec;
+	struct item_list *l = &in->items;
+	struct item *item;
+	int fd, ret;
+
+	fd = open(in->in_path, O_RDONLY);
+	if (fd < 0)
+		return MULTI_EREAD;
+	if (!nm_parser_init(&in->parser, fd)) {
+		close(fd);
+		return 0;
+	}
+	in->parsed = true;
+	in->in_order = true;
+
+	if (in->parser.mapped && is_elf(in->parser.buf, in->parser.len)) {
+		if (!elf_symtab_init(&symtab, in->parser.buf, in->parser.len)) {
+			close(fd);
+			return MULTI_EREAD;
+		}
+		in->elf = true;
+	} else if (skip_marker(&in->parser)) {
+		in->processed = true;
+		ret = write_processed(in);
+		close(fd);
+		return ret;
+	}
+
+	while ((ret = in->elf ? elf_next_record(&symtab, &rec) :
+		      nm_next_record(&in->parser, &rec)) > 0) {
+		if (l->count && rec.addr < l->items[l->count - 1].addr)
+			in->in_order = false;
+		if (in->parser.mapped)
+			item = add_item_ref(l, rec.name, rec.name_len, rec.stype, rec.addr);
+		else
+			item = add_item(l, rec.name, rec.name_len, rec.stype, rec.addr);
+		if (!item) {
+			close(fd);
+			return 0;
+		}
+	}
+
+	/* a mapping outlives its descriptor; thousands of modules would not */
+	close(fd);
+	in->parser.fd = -1;
+	if (ret < 0 || in->parser.malformed)
+		return MULTI_EREAD;
+	if (!in->parser.mapped) {
+		nm_parser_free(&in->parser);
+		in->parsed = false;
+	}
+
+	return in->in_order ? 1 : sort_list_m(l, BY_ADDRESS);
+}
+
+static bool range_has_aliases(const struct item_list *list, size_t start, size_t count)
+{
+	size_t i;
+
+	for (i = start; i < start + count; i++)
+		if (list->items[i].alias)
+			return true;
+	return false;
+}
+
+/*
+ * Writes the table of one input. An nm file in address order that got no
+ * aliases and lists no undefined symbols is copied, reopened so that the
+ * kernel can do it.
+ */
+static int write_one(struct multi_input *in, const struct item_list *list)
+{
+	struct output out;
+	int fd, in_fd, ret;
+	size_t i;
+
+	if (in->processed)
+		return 1;
+
+	fd = open(in->out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return MULTI_EWRITE;
+	if (!out_init(&out, fd)) {
+		close(fd);
+		return 0;
+	}
+
+	out_marker(&out);
+	if (!in->elf && in->parsed && !in->parser.skipped && in->in_order &&
+	    !range_has_aliases(list, in->start, in->count)) {
+		in_fd = open(in->in_path, O_RDONLY);
+		out_copy(&out, in_fd, 0, in->parser.buf, in->parser.len);
+		if (in_fd >= 0)
+			close(in_fd);
+	} else {
+		for (i = in->start; i < in->start + in->count; i++)
+			out_item(&out, &list->items[i]);
+	}
+
+	ret = out_flush(&out) ? 1 : MULTI_EWRITE;
+	out_free(&out);
+	if (close(fd) && ret > 0)
+		ret = MULTI_EWRITE;
+	return ret;
+}
+
+static void *parse_worker(void *arg)
+{
+	struct multi_run *r = ((struct multi_job *)arg)->run;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED)) < r->count)
+		r->inputs[i].status = parse_one(&r->inputs[i]);
+	return NULL;
+}
+
+static void *write_worker(void *arg)
+{
+	struct multi_run *r = ((struct multi_job *)arg)->run;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED)) < r->count)
+		r->inputs[i].status = write_one(&r->inputs[i], &r->list);
+	return NULL;
+}
+
+/* Hands the inputs out to jobs threads; the first failure in list order is reported. */
+static int run_inputs(struct multi_run *r, void *(*fn)(void *), int jobs)
+{
+	struct multi_job job[MAX_JOBS];
+	struct multi_input *in;
+	size_t i;
+
+	if ((size_t)jobs > r->count)
+		jobs = r->count ? r->count : 1;
+	for (i = 0; i < (size_t)jobs; i++)
+		job[i].run = r;
+
+	r->next = 0;
+	parallel_run(fn, job, sizeof(*job), jobs);
+
+	for (i = 0; i < r->count; i++) {
+		in = &r->inputs[i];
+		if (in->status == 1)
+			continue;
+		r->bad = in->status == MULTI_EWRITE ? in->out_path : in->in_path;
+		return in->status;
+	}
+	return 1;
+}
+
+int multi_parse(struct multi_run *r, int jobs)
+{
+	return run_inputs(r, parse_worker, jobs);
+}
+
+/* Moves the items of every input into the joined list, in list order. */
+int multi_join(struct multi_run *r)
+{
+	struct multi_input *in;
+	size_t i, total = 0;
+
+	for (i = 0; i < r->count; i++)
+		total += r->inputs[i].items.count;
+	if (!item_list_reserve(&r->list, total))
+		return 0;
+
+	for (i = 0; i < r->count; i++) {
+		in = &r->inputs[i];
+		in->start = r->list.count;
+		in->count = in->items.count;
+		if (in->count)
+			memcpy(r->list.items + in->start, in->items.items,
+			       in->count * sizeof(struct item));
+		r->list.count += in->count;
+
+		/* unmapped inputs keep their names in the list's arena */
+		kas_free(in->items.items);
+		in->items.items = NULL;
+		in->items.count = 0;
+		in->items.capacity = 0;
+	}
+	return 1;
+}
+
+int multi_write(struct multi_run *r, int jobs)
+{
+	return run_inputs(r, write_worker, jobs);
+}
+
+void multi_free(struct multi_run *r)
+{
+	struct multi_input *in;
+	size_t i;
+
+	for (i = 0; i < r->count; i++) {
+		in = &r->inputs[i];
+		free_items(&in->items);
+		if (in->parsed)
+			nm_parser_free(&in->parser);
+		kas_free(in->in_path);
+		kas_free(in->out_path);
+	}
+	kas_free(r->inputs);
+	free_items(&r->list);
+	memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef MULTI_INPUT_H
+#define MULTI_INPUT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "item_list.h"
+#include "nm_parser.h"
+
+/*
+ * One nm or ELF input of a -multi run and the table written for it. The
+ * parser keeps a mapped input mapped, as its items name into it.
+ */
+struct multi_input {
+	char			*in_path;
+	char			*out_path;
+	struct nm_parser	parser;
+	bool			parsed;		/* parser needs freeing */
+	bool			elf;
+	bool			in_order;	/* addresses ascended in the file */
+	bool			processed;	/* passed through while parsing */
+	struct item_list	items;		/* moved to the joined list */
+	size_t			start;		/* first item in the joined list */
+	size_t			count;
+	int			status;
+};
+
+/*
+ * vmlinux and its modules, aliased as one symbol set: a name gets aliases
+ * when it occurs more than once over all the inputs, numbered in list
+ * order and, within an input, by address. The list file has one
+ * "<input> <output>" line per input.
+ *
+ * The functions return 1 on success, 0 if memory ran out, MULTI_EREAD
+ * if an input cannot be read and MULTI_EWRITE if an output cannot be
+ * written; bad then names the file.
+ */
+#define MULTI_EREAD -1
+#define MULTI_EWRITE -2
+
+struct multi_run {
+	struct multi_input	*inputs;
+	size_t			count;
+	size_t			cap;
+	size_t			next;		/* taken by the workers */
+	struct item_list	list;		/* every input's items, one after another */
+	const char		*bad;
+};
+
+int multi_load(struct multi_run *r, const char *path);
+int multi_parse(struct multi_run *r, int jobs);
+int multi_join(struct multi_run *r);
+int multi_write(struct multi_run *r, int jobs);
+void multi_free(struct multi_run *r);
+#endif
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nm_parser.h"
+#include "alloc.h"
+#include "stats.h"
+
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define NOT_HEX 0x10
+
+/* the ranges between the digits are spelled out, no entry is set twice */
+static const unsigned char hexval[256] = {
+	[0 ... '0' - 1] = NOT_HEX,
+	['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4,
+	['5'] = 5, ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9,
+	['9' + 1 ... 'A' - 1] = NOT_HEX,
+	['A'] = 10, ['B'] = 11, ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15,
+	['F' + 1 ... 'a' - 1] = NOT_HEX,
+	['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15,
+	['f' + 1 ... 255] = NOT_HEX,
+};
+
+static inline bool is_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*
+ * Top bit set in every byte of x strictly between m and n; exact per byte
+ * as long as the byte is below 0x80, which any hex digit is.
+ */
+static inline uint64_t bytes_between(uint64_t x, uint64_t m, uint64_t n)
+{
+	return (ONES * (127 + n) - (x & ONES * 127)) & ~x &
+	       ((x & ONES * 127) + ONES * (127 - m)) & HIGHS;
+}
+
+/* Validate and decode eight hex digits at once, without per-digit branches. */
+static inline bool hex8(const char *s, uint32_t *out)
+{
+	uint64_t w, n;
+
+	memcpy(&w, s, sizeof(w));
+	w = le64toh(w);
+	if ((bytes_between(w, '0' - 1, '9' + 1) |
+	     bytes_between(w | ONES * 0x20, 'a' - 1, 'f' + 1)) != HIGHS)
+		return false;
+
+	/* per byte digit value, then fold nibble pairs, byte pairs, halves */
+	n = (w & ONES * 0x0f) + ((w >> 6) & ONES) * 9;
+	n = ((n & 0x00ff00ff00ff00ffULL) << 4) | ((n >> 8) & 0x00ff00ff00ff00ffULL);
+	n = ((n & 0x0000ffff0000ffffULL) << 8) | ((n >> 16) & 0x0000ffff0000ffffULL);
+	*out = ((n & 0xffffffffULL) << 16) | (n >> 32);
+	return true;
+}
+
+/* Returns NULL if [p, end) is not a "<hex> <type> <name>" line. */
+static const char *parse_line(const char *p, const char *end, struct nm_record *rec)
+{
+	uint64_t addr = 0;
+	const char *start;
+	uint32_t hi, lo;
+	unsigned char v;
+
+	while (p < end && is_blank(*p))
+		p++;
+
+	start = p;
+	if (end - p > 16 && is_blank(p[16]) && hex8(p, &hi) && hex8(p + 8, &lo)) {
+		addr = (uint64_t)hi << 32 | lo;
+		p += 16;
+	} else {
+		while (p < end && p - start < 16 && (v = hexval[(unsigned char)*p]) != NOT_HEX) {
+			addr = addr << 4 | v;
+			p++;
+		}
+	}
+
+	if (p == start || p == end || !is_blank(*p))
+		return NULL;
+
+	while (p < end && is_blank(*p))
+		p++;
+	if (p == end)
+		return NULL;
+
+	rec->stype = *p++;
+	if (p == end || !is_blank(*p))
+		return NULL;
+
+	while (p < end && is_blank(*p))
+		p++;
+
+	start = p;
+	while (p < end && !is_blank(*p))
+		p++;
+	if (p == start)
+		return NULL;
+
+	rec->addr = addr;
+	rec->name = start;
+	rec->name_len = p - start;
+	return p;
+}
+
+static bool is_empty_line(const char *p, const char *end)
+{
+	while (p < end && is_blank(*p))
+		p++;
+	return p == end;
+}
+
+/* nm leaves the address of undefined symbols blank: "<type> <name>". */
+static bool is_unaddressed_line(const char *p, const char *end)
+{
+	while (p < end && is_blank(*p))
+		p++;
+	if (end - p < 3 || !is_blank(p[1]))
+		return false;
+
+	p += 2;
+	while (p < end && is_blank(*p))
+		p++;
+	if (p == end)
+		return false;
+	while (p < end && !is_blank(*p))
+		p++;
+	return is_empty_line(p, end);
+}
+
+/* Keep the unparsed tail, grow the buffer if one line fills it, read more. */
+static int refill(struct nm_parser *p)
+{
+	size_t tail = p->len - p->pos;
+	char *buf;
+	ssize_t n;
+
+	memmove(p->buf, p->buf + p->pos, tail);
+	p->len = tail;
+	p->pos = 0;
+
+	if (p->len == p->cap) {
+		buf = kas_realloc(p->buf, p->cap, p->cap * 2);
+		if (!buf)
+			return -1;
+		p->buf = buf;
+		p->cap *= 2;
+	}
+
+	do {
+		n = read(p->fd, p->buf + p->len, p->cap - p->len);
+	} while (n < 0 && errno == EINTR);
+
+	if (n < 0)
+		return -1;
+	if (!n)
+		p->eof = true;
+	p->len += n;
+	kas_stats.input_bytes += n;
+	return 0;
+}
+
+/*
+ * Regular files are mapped whole, so records can point straight into the
+ * file; pipes and anything mmap() refuses go through buffered reads.
+ */
+static bool map_input(struct nm_parser *p, int fd)
+{
+	struct stat st;
+	void *map;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size)
+		return false;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return false;
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	kas_stats.input_bytes += st.st_size;
+	p->fd = fd;
+	p->buf = map;
+	p->cap = st.st_size;
+	p->len = st.st_size;
+	p->pos = 0;
+	p->eof = true;
+	p->mapped = true;
+	p->malformed = false;
+	p->skipped = false;
+	return true;
+}
+
+int nm_parser_init(struct nm_parser *p, int fd)
+{
+	if (map_input(p, fd))
+		return 1;
+
+	p->mapped = false;
+	p->buf = kas_malloc(NM_READ_BLOCK);
+	if (!p->buf)
+		return 0;
+
+	p->fd = fd;
+	p->cap = NM_READ_BLOCK;
+	p->len = 0;
+	p->pos = 0;
+	p->eof = false;
+	p->malformed = false;
+	p->skipped = false;
+	return 1;
+}
+
+/*
+ * A parser over the bytes [start, end) of a mapped parent, so that parts of
+ * one file can be parsed concurrently. Slices own nothing and are never
+ * passed to nm_parser_free().
+ */
+void nm_parser_slice(struct nm_parser *p, const struct nm_parser *parent,
+		     size_t start, size_t end)
+{
+	p->fd = -1;
+	p->buf = parent->buf + start;
+	p->cap = end - start;
+	p->len = end - start;
+	p->pos = 0;
+	p->eof = true;
+	p->mapped = true;
+	p->malformed = false;
+	p->skipped = false;
+}
+
+/*
+ * Returns 1 and fills rec for each symbol line, 0 at end of input or from
+ * the first line that does not parse on, -1 on a read or allocation
+ * error. Blank lines are skipped, and so are undefined symbols, listed
+ * without address or as U, as scripts/kallsyms ignores them: module
+ * listings start with them.
+ */
+int nm_next_record(struct nm_parser *p, struct nm_record *rec)
+{
+	const char *line, *nl;
+
+	if (p->malformed)
+		return 0;
+
+	for (;;) {
+		line = p->buf + p->pos;
+		nl = memchr(line, '\n', p->len - p->pos);
+		if (!nl) {
+			if (!p->eof) {
+				if (refill(p) < 0)
+					return -1;
+				continue;
+			}
+			if (p->pos == p->len)
+				return 0;
+			nl = p->buf + p->len;
+		}
+
+		p->pos = nl - p->buf;
+		if (p->pos < p->len)
+			p->pos++;
+
+		if (is_empty_line(line, nl))
+			continue;
+
+		if (parse_line(line, nl, rec)) {
+			if (rec->stype != 'U')
+				return 1;
+		} else if (!is_unaddressed_line(line, nl)) {
+			p->malformed = true;
+			return 0;
+		}
+		p->skipped = true;
+	}
+}
+
+/* Like nm_next_record(), but the record is read again by the next call. */
+int nm_peek_record(struct nm_parser *p, struct nm_record *rec)
+{
+	const char *line;
+	int ret;
+
+	ret = nm_next_record(p, rec);
+	if (ret > 0) {
+		/* a refill may have moved the line, but not the name within it */
+		line = memrchr(p->buf, '\n', rec->name - p->buf);
+		p->pos = line ? (size_t)(line - p->buf) + 1 : 0;
+	}
+	return ret;
+}
+
+/*
+ * The bytes not yet parsed, as they are: returns 1 with the next chunk
+ * in *data, 0 once the input is exhausted and -1 on a read error. A
+ * mapped input comes in one chunk.
+ */
+int nm_next_chunk(struct nm_parser *p, const char **data, size_t *len)
+{
+	while (p->pos == p->len) {
+		if (p->eof)
+			return 0;
+		if (refill(p) < 0)
+			return -1;
+	}
+
+	*data = p->buf + p->pos;
+	*len = p->len - p->pos;
+	p->pos = p->len;
+	return 1;
+}
+
+void nm_parser_free(struct nm_parser *p)
+{
+	if (p->mapped)
+		munmap(p->buf, p->cap);
+	else
+		kas_free(p->buf);
+	p->buf = NULL;
+}
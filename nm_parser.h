@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef NM_PARSER_H
+#define NM_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define NM_READ_BLOCK (1 << 20)
+
+/*
+ * One "<hex address> <type> <name>" line. name points into the parser
+ * buffer and stays valid until the next call to nm_next_record(), or until
+ * nm_parser_free() if the input is mapped.
+ */
+struct nm_record {
+	uint64_t	addr;
+	const char	*name;
+	size_t		name_len;
+	char		stype;
+};
+
+struct nm_parser {
+	int		fd;
+	char		*buf;
+	size_t		cap;
+	size_t		len;
+	size_t		pos;
+	bool		eof;
+	bool		mapped;
+	bool		malformed;	/* stopped at a line that does not parse */
+	bool		skipped;	/* left out an undefined symbol */
+};
+
+int nm_parser_init(struct nm_parser *p, int fd);
+void nm_parser_slice(struct nm_parser *p, const struct nm_parser *parent,
+		     size_t start, size_t end);
+int nm_next_record(struct nm_parser *p, struct nm_record *rec);
+int nm_peek_record(struct nm_parser *p, struct nm_record *rec);
+int nm_next_chunk(struct nm_parser *p, const char **data, size_t *len);
+void nm_parser_free(struct nm_parser *p);
+#endif
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/sendfile.h>
+
+#include "output.h"
+#include "linker_map.h"
+#include "alloc.h"
+#include "stats.h"
+
+/* nm prints at least 8 digits; 16 digits, type and two blanks worst case */
+#define SYMBOL_HEAD_SIZE 19
+
+static const char hex_pairs[] =
+	"000102030405060708090a0b0c0d0e0f"
+	"101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f"
+	"303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f"
+	"505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f"
+	"707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f"
+	"909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+	"b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+	"d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+	"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static void write_all(struct output *o, const char *data, size_t len)
+{
+	ssize_t n;
+
+	while (len && !o->error) {
+		n = write(o->fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			o->error = true;
+			break;
+		}
+		data += n;
+		len -= n;
+		kas_stats.output_bytes += n;
+	}
+}
+
+static void flush_buf(struct output *o)
+{
+	write_all(o, o->buf, o->len);
+	o->len = 0;
+}
+
+/* Same digits as printf("%08lx"), two at a time from a lookup table. */
+static inline size_t format_hex(char *p, uint64_t v)
+{
+	size_t digits = v >> 32 ? (67 - __builtin_clzll(v)) / 4 : 8;
+	char *q = p + digits;
+
+	while (q - p >= 2) {
+		q -= 2;
+		memcpy(q, &hex_pairs[(v & 0xff) * 2], 2);
+		v >>= 8;
+	}
+	if (q > p)
+		*--q = hex_pairs[(v & 0xf) * 2 + 1];
+
+	return digits;
+}
+
+static inline size_t format_head(char *p, uint64_t addr, char stype)
+{
+	size_t len = format_hex(p, addr);
+
+	p[len++] = ' ';
+	p[len++] = stype;
+	p[len++] = ' ';
+	return len;
+}
+
+int out_init(struct output *o, int fd)
+{
+	o->buf = kas_malloc(OUTPUT_BUF_SIZE);
+	if (!o->buf)
+		return 0;
+
+	o->fd = fd;
+	o->len = 0;
+	o->cap = OUTPUT_BUF_SIZE;
+	o->error = false;
+	o->map = NULL;
+	return 1;
+}
+
+/*
+ * An output that only collects into memory, for formatting part of the
+ * table off the main thread. size must cover everything written to it;
+ * out_item_size() gives the bound per item. The buffer is exactly that
+ * size, and none is taken for an empty range.
+ */
+int out_init_mem(struct output *o, size_t size)
+{
+	o->buf = NULL;
+	if (size) {
+		o->buf = kas_malloc(size);
+		if (!o->buf)
+			return 0;
+	}
+
+	o->fd = -1;
+	o->len = 0;
+	o->cap = size;
+	o->error = false;
+	o->map = NULL;
+	return 1;
+}
+
+void out_write(struct output *o, const char *data, size_t len)
+{
+	if (o->cap - o->len < len) {
+		flush_buf(o);
+		if (len > o->cap) {
+			write_all(o, data, len);
+			return;
+		}
+	}
+	memcpy(o->buf + o->len, data, len);
+	o->len += len;
+}
+
+/*
+ * Appends len bytes of the file fd starting at offset, which are also
+ * mapped at data. Where the kernel can, it copies them file to file
+ * (copy_file_range) or file to pipe (sendfile) without a pass through
+ * user space; whatever it refuses is written from data.
+ */
+void out_copy(struct output *o, int fd, off_t offset, const char *data, size_t len)
+{
+	ssize_t n;
+
+	flush_buf(o);
+
+	while (len && !o->error) {
+		n = copy_file_range(fd, &offset, o->fd, NULL, len, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		data += n;
+		len -= n;
+		kas_stats.output_bytes += n;
+	}
+
+	while (len && !o->error) {
+		n = sendfile(o->fd, fd, &offset, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		data += n;
+		len -= n;
+		kas_stats.output_bytes += n;
+	}
+
+	write_all(o, data, len);
+}
+
+/* One "<addr> <type> <name><suffix>" line. */
+void out_symbol(struct output *o, uint64_t addr, char stype,
+		const char *name, size_t name_len, const char *suffix, size_t suffix_len)
+{
+	size_t need = SYMBOL_HEAD_SIZE + name_len + suffix_len + 1;
+	char head[SYMBOL_HEAD_SIZE];
+	char *p;
+
+	if (o->cap - o->len < need) {
+		flush_buf(o);
+		if (need > o->cap) {
+			out_write(o, head, format_head(head, addr, stype));
+			out_write(o, name, name_len);
+			out_write(o, suffix, suffix_len);
+			out_write(o, "\n", 1);
+			return;
+		}
+	}
+
+	p = o->buf + o->len;
+	p += format_head(p, addr, stype);
+	memcpy(p, name, name_len);
+	p += name_len;
+	memcpy(p, suffix, suffix_len);
+	p += suffix_len;
+	*p++ = '\n';
+	o->len = p - o->buf;
+}
+
+void out_marker(struct output *o)
+{
+	out_symbol(o, 0, ALIAS_MARKER_TYPE, ALIAS_MARKER, sizeof(ALIAS_MARKER) - 1, "", 0);
+}
+
+/* Consumes the marker line if the input starts with one. */
+bool skip_marker(struct nm_parser *parser)
+{
+	struct nm_record rec;
+
+	if (nm_peek_record(parser, &rec) <= 0 || rec.stype != ALIAS_MARKER_TYPE || rec.addr ||
+	    rec.name_len != sizeof(ALIAS_MARKER) - 1 ||
+	    memcmp(rec.name, ALIAS_MARKER, rec.name_len) != 0)
+		return false;
+
+	return nm_next_record(parser, &rec) > 0;
+}
+
+/*
+ * Copies processed input to the output without parsing it again: a
+ * mapped file in one go by the kernel, a pipe through the read buffer.
+ * Returns -1 on a read error.
+ */
+int out_pass_through(struct output *o, struct nm_parser *parser)
+{
+	const char *data;
+	size_t len;
+	int ret;
+
+	out_marker(o);
+	if (parser->mapped) {
+		out_copy(o, parser->fd, parser->pos, parser->buf + parser->pos,
+			 parser->len - parser->pos);
+		parser->pos = parser->len;
+		return 0;
+	}
+	while ((ret = nm_next_chunk(parser, &data, &len)) > 0)
+		out_write(o, data, len);
+	return ret;
+}
+
+/*
+ * The k-th symbol of a name, counting by address from 1, is aliased as
+ * name__alias__k: the suffix depends on nothing but the symbols sharing
+ * the name, so it stays put when unrelated code changes. buf must hold
+ * ALIAS_SUFFIX_SIZE bytes; returns the suffix length.
+ */
+size_t alias_suffix(char *buf, uint32_t ordinal)
+{
+	return sprintf(buf, "__alias__%u", ordinal);
+}
+
+void out_alias(struct output *o, uint64_t addr, char stype,
+	       const char *name, size_t name_len, uint32_t ordinal)
+{
+	char suffix[ALIAS_SUFFIX_SIZE];
+
+	out_symbol(o, addr, stype, name, name_len, suffix, alias_suffix(suffix, ordinal));
+}
+
+/*
+ * Length of what out_alias_suffix() writes for an aliased item:
+ * "@<object file>" when the map names it, alias_suffix() otherwise.
+ */
+size_t alias_suffix_size(const struct linker_map *map, const struct item *item)
+{
+	size_t len = sizeof("__alias__");
+	uint32_t v;
+
+	if (item->obj)
+		return 1 + map->files[item->obj - 1].name_len;
+	for (v = item->alias; v >= 10; v /= 10)
+		len++;
+	return len;
+}
+
+void out_alias_suffix(struct output *o, const struct item *item)
+{
+	const struct map_file *file;
+	char suffix[ALIAS_SUFFIX_SIZE];
+
+	if (!item->obj) {
+		out_write(o, suffix, alias_suffix(suffix, item->alias));
+		return;
+	}
+	file = &o->map->files[item->obj - 1];
+	out_write(o, "@", 1);
+	out_write(o, file->name, file->name_len);
+}
+
+size_t out_item_size(const struct linker_map *map, const struct item *item)
+{
+	size_t size = SYMBOL_HEAD_SIZE + item->name_len + 1;
+
+	if (item->alias)
+		size += SYMBOL_HEAD_SIZE + item->name_len + alias_suffix_size(map, item) + 1;
+	return size;
+}
+
+/* The item's line, followed by its alias if it has one. */
+void out_item(struct output *o, const struct item *item)
+{
+	char head[SYMBOL_HEAD_SIZE];
+
+	out_symbol(o, item->addr, item->stype, item->symb_name, item->name_len, "", 0);
+	if (!item->alias)
+		return;
+
+	if (!item->obj) {
+		out_alias(o, item->addr, item->stype, item->symb_name, item->name_len,
+			  item->alias);
+		return;
+	}
+	out_write(o, head, format_head(head, item->addr, item->stype));
+	out_write(o, item->symb_name, item->name_len);
+	out_alias_suffix(o, item);
+	out_write(o, "\n", 1);
+}
+
+/* Returns 0 if any write since out_init() failed. */
+int out_flush(struct output *o)
+{
+	flush_buf(o);
+	return !o->error;
+}
+
+void out_free(struct output *o)
+{
+	kas_free(o->buf);
+	o->buf = NULL;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "item_list.h"
+#include "nm_parser.h"
+
+struct linker_map;
+
+#define OUTPUT_BUF_SIZE (1 << 20)
+#define ALIAS_SUFFIX_SIZE 24
+
+/*
+ * An absolute symbol at 0, which scripts/kallsyms drops, opening every
+ * table kas_alias writes as text. Input that starts with it has been
+ * through kas_alias already.
+ */
+#define ALIAS_MARKER "__kas_alias_marker"
+#define ALIAS_MARKER_TYPE 'a'
+
+/*
+ * Lines are formatted straight into a large buffer that is handed to
+ * write() when full. Errors are sticky and reported by out_flush().
+ * Items with an obj are aliased after that file of map.
+ */
+struct output {
+	int			fd;
+	char			*buf;
+	size_t			len;
+	size_t			cap;
+	bool			error;
+	const struct linker_map	*map;
+};
+
+int out_init(struct output *o, int fd);
+int out_init_mem(struct output *o, size_t size);
+void out_write(struct output *o, const char *data, size_t len);
+void out_copy(struct output *o, int fd, off_t offset, const char *data, size_t len);
+void out_symbol(struct output *o, uint64_t addr, char stype,
+		const char *name, size_t name_len, const char *suffix, size_t suffix_len);
+void out_marker(struct output *o);
+bool skip_marker(struct nm_parser *parser);
+int out_pass_through(struct output *o, struct nm_parser *parser);
+size_t alias_suffix(char *buf, uint32_t ordinal);
+void out_alias(struct output *o, uint64_t addr, char stype,
+	       const char *name, size_t name_len, uint32_t ordinal);
+size_t alias_suffix_size(const struct linker_map *map, const struct item *item);
+void out_alias_suffix(struct output *o, const struct item *item);
+size_t out_item_size(const struct linker_map *map, const struct item *item);
+void out_item(struct output *o, const struct item *item);
+int out_flush(struct output *o);
+void out_free(struct output *o);
+#endif
@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "parallel.h"
+#include "duplicates_list.h"
+#include "alloc.h"
+
+struct parse_job {
+	struct nm_parser	parser;
+	struct item_list	items;
+	bool			sorted;
+	bool			failed;
+};
+
+struct dedup_job {
+	struct item_list	*list;
+	size_t			*index;
+	size_t			*slot;
+	uint32_t		shards;
+	size_t			start;
+	size_t			end;
+	bool			failed;
+};
+
+struct write_job {
+	const struct item_list	*list;
+	const struct linker_map	*map;
+	struct output		out;
+	size_t			start;
+	size_t			end;
+	bool			failed;
+};
+
+/*
+ * Runs fn on each of the n jobs, job 0 on the calling thread. A job whose
+ * thread cannot be created runs on the calling thread as well.
+ */
+void parallel_run(void *(*fn)(void *), void *jobs, size_t job_size, int n)
+{
+	bool started[MAX_JOBS];
+	pthread_t tid[MAX_JOBS];
+	int i;
+
+	for (i = 1; i < n; i++)
+		started[i] = !pthread_create(&tid[i], NULL, fn, (char *)jobs + i * job_size);
+
+	fn(jobs);
+	for (i = 1; i < n; i++) {
+		if (started[i])
+			pthread_join(tid[i], NULL);
+		else
+			fn((char *)jobs + i * job_size);
+	}
+}
+
+static void *parse_chunk(void *arg)
+{
+	struct parse_job *job = arg;
+	struct nm_record rec;
+	struct item_list *l = &job->items;
+
+	job->sorted = true;
+	while (nm_next_record(&job->parser, &rec) > 0) {
+		if (l->count && rec.addr < l->items[l->count - 1].addr)
+			job->sorted = false;
+		if (!add_item_ref(l, rec.name, rec.name_len, rec.stype, rec.addr)) {
+			job->failed = true;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/* Start of the line following offset, or len. */
+static size_t line_after(const char *buf, size_t len, size_t offset)
+{
+	const char *nl;
+
+	if (!offset)
+		return 0;
+	nl = memchr(buf + offset - 1, '\n', len - offset + 1);
+	return nl ? (size_t)(nl - buf) + 1 : len;
+}
+
+/*
+ * Splits the unread part of a mapped input into line aligned chunks,
+ * parses them concurrently and joins the records in file order. As in
+ * the serial loop, parsing ends at the first line that does not parse,
+ * which leaves parser malformed.
+ */
+int parallel_parse(struct item_list *list, struct nm_parser *parser, int jobs,
+		   bool *addr_sorted)
+{
+	const struct item *last = NULL;
+	struct parse_job *job;
+	size_t start, end, total;
+	int i, n, ret = 0;
+
+	job = kas_calloc(jobs, sizeof(*job));
+	if (!job)
+		return 0;
+
+	for (i = 0, start = parser->pos; i < jobs; i++, start = end) {
+		end = line_after(parser->buf, parser->len,
+				 parser->pos + (parser->len - parser->pos) / jobs * (i + 1));
+		if (i == jobs - 1)
+			end = parser->len;
+		nm_parser_slice(&job[i].parser, parser, start, end);
+	}
+
+	parallel_run(parse_chunk, job, sizeof(*job), jobs);
+
+	for (n = 0, total = 0; n < jobs; n++) {
+		if (job[n].failed)
+			goto out;
+		total += job[n].items.count;
+		if (job[n].parser.skipped)
+			parser->skipped = true;
+		if (job[n].parser.malformed) {
+			parser->malformed = true;
+			n++;
+			break;
+		}
+	}
+
+	if (!item_list_reserve(list, total))
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		if (!job[i].items.count)
+			continue;
+		if (!job[i].sorted || (last && job[i].items.items[0].addr < last->addr))
+			*addr_sorted = false;
+		memcpy(list->items + list->count, job[i].items.items,
+		       job[i].items.count * sizeof(struct item));
+		list->count += job[i].items.count;
+		last = &list->items[list->count - 1];
+	}
+	parser->pos = parser->len;
+	ret = 1;
+out:
+	for (i = 0; i < jobs; i++)
+		free_items(&job[i].items);
+	kas_free(job);
+	return ret;
+}
+
+static inline uint32_t shard_of(uint32_t hash, uint32_t shards)
+{
+	/* high bits: the table index uses the low ones */
+	return (uint64_t)hash * shards >> 32;
+}
+
+/* Counts the items of one range per shard. */
+static void *count_range(void *arg)
+{
+	struct dedup_job *job = arg;
+	const struct item *items = job->list->items;
+	size_t i;
+
+	for (i = job->start; i < job->end; i++)
+		job->slot[shard_of(items[i].hash, job->shards)]++;
+	return NULL;
+}
+
+/* Puts the index of each item of one range in the slice of its shard. */
+static void *scatter_range(void *arg)
+{
+	struct dedup_job *job = arg;
+	const struct item *items = job->list->items;
+	size_t i;
+
+	for (i = job->start; i < job->end; i++)
+		job->index[job->slot[shard_of(items[i].hash, job->shards)]++] = i;
+	return NULL;
+}
+
+/*
+ * Numbers the items of one shard in list order, like
+ * find_duplicates_hash() does for the whole list. A name whose first
+ * item is still alone once the shard is done has no duplicates.
+ */
+static void *dedup_shard(void *arg)
+{
+	struct dedup_job *job = arg;
+	const size_t *index = job->index + job->start;
+	struct item_list *list = job->list;
+	size_t i, count = job->end - job->start;
+	struct dup_entry *entry;
+	struct dup_table table;
+	struct item *item;
+
+	if (!dup_table_init(&table, count)) {
+		job->failed = true;
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		item = &list->items[index[i]];
+		entry = dup_table_insert(&table, item->symb_name, item->name_len, item->hash);
+		if (!entry) {
+			job->failed = true;
+			break;
+		}
+		item->alias = ++entry->count;
+	}
+
+	for (i = 0; i < count && !job->failed; i++) {
+		item = &list->items[index[i]];
+		if (item->alias != 1)
+			continue;
+		entry = dup_table_find(&table, item->symb_name, item->name_len, item->hash);
+		if (entry->count == 1)
+			item->alias = 0;
+	}
+
+	dup_table_free(&table);
+	return NULL;
+}
+
+/*
+ * Address ordered input: each thread owns the names whose hash, taken
+ * while parsing, falls in its shard, so no table is shared. The items are
+ * first sorted into one slice of indices per shard, in list order: each
+ * thread counts its range per shard, then writes the indices of the
+ * range into the place the counts give it.
+ */
+int parallel_find_duplicates(struct item_list *list, int jobs)
+{
+	struct dedup_job *job;
+	size_t *index, *slot, pos;
+	int i, s, ret = 1;
+
+	if (!list->count)
+		return 1;
+
+	job = kas_calloc(jobs, sizeof(*job));
+	slot = kas_calloc((size_t)jobs * jobs, sizeof(*slot));
+	index = kas_malloc(list->count * sizeof(*index));
+	if (!job || !slot || !index) {
+		ret = 0;
+		goto out;
+	}
+
+	for (i = 0; i < jobs; i++) {
+		job[i].list = list;
+		job[i].index = index;
+		job[i].slot = slot + (size_t)i * jobs;
+		job[i].shards = jobs;
+		job[i].start = list->count / jobs * i;
+		job[i].end = i == jobs - 1 ? list->count : list->count / jobs * (i + 1);
+	}
+	parallel_run(count_range, job, sizeof(*job), jobs);
+
+	/* shard s of range i goes after all of the lower shards and lower ranges */
+	for (s = 0, pos = 0; s < jobs; s++) {
+		for (i = 0; i < jobs; i++) {
+			size_t n = job[i].slot[s];
+
+			job[i].slot[s] = pos;
+			pos += n;
+		}
+	}
+	parallel_run(scatter_range, job, sizeof(*job), jobs);
+
+	/* after the scatter, range jobs - 1 ends where each shard does */
+	for (s = 0, pos = 0; s < jobs; s++) {
+		job[s].start = pos;
+		job[s].end = pos = job[jobs - 1].slot[s];
+	}
+	parallel_run(dedup_shard, job, sizeof(*job), jobs);
+
+	for (i = 0; i < jobs; i++)
+		if (job[i].failed)
+			ret = 0;
+out:
+	kas_free(index);
+	kas_free(slot);
+	kas_free(job);
+	return ret;
+}
+
+static void *format_range(void *arg)
+{
+	struct write_job *job = arg;
+	size_t i, size = 0;
+
+	for (i = job->start; i < job->end; i++)
+		size += out_item_size(job->map, &job->list->items[i]);
+
+	if (!out_init_mem(&job->out, size)) {
+		job->failed = true;
+		return NULL;
+	}
+	job->out.map = job->map;
+
+	for (i = job->start; i < job->end; i++)
+		out_item(&job->out, &job->list->items[i]);
+	return NULL;
+}
+
+/* Formats ranges of the table concurrently and writes them in order. */
+int parallel_write(struct output *out, const struct item_list *list, int jobs)
+{
+	struct write_job *job;
+	int i, ret = 1;
+
+	job = kas_calloc(jobs, sizeof(*job));
+	if (!job)
+		return 0;
+
+	for (i = 0; i < jobs; i++) {
+		job[i].list = list;
+		job[i].map = out->map;
+		job[i].start = list->count / jobs * i;
+		job[i].end = i == jobs - 1 ? list->count : list->count / jobs * (i + 1);
+	}
+
+	parallel_run(format_range, job, sizeof(*job), jobs);
+
+	for (i = 0; i < jobs; i++) {
+		if (job[i].failed)
+			ret = 0;
+		else if (ret && job[i].out.len)
+			out_write(out, job[i].out.buf, job[i].out.len);
+		out_free(&job[i].out);
+	}
+
+	kas_free(job);
+	return ret;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+
+#include "item_list.h"
+#include "nm_parser.h"
+#include "output.h"
+
+#define MAX_JOBS 256
+
+/* Runs fn on each of n jobs of job_size bytes, concurrently where it can. */
+void parallel_run(void *(*fn)(void *), void *jobs, size_t job_size, int n);
+
+/*
+ * Multithreaded versions of the batch phases, for -j, giving the same
+ * result as the serial ones; parallel_find_duplicates() numbers in list
+ * order, so it does only on address ordered lists. Each returns 1 on
+ * success and 0 if memory ran out; work that cannot get a thread runs
+ * on the calling one.
+ */
+int parallel_parse(struct item_list *list, struct nm_parser *parser, int jobs,
+		   bool *addr_sorted);
+int parallel_find_duplicates(struct item_list *list, int jobs);
+int parallel_write(struct output *out, const struct item_list *list, int jobs);
+#endif
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+struct kas_stats kas_stats;
+
+static const char *const phase_names[PHASE_COUNT] = {
+	[PHASE_PARSE]	= "parse",
+	[PHASE_STATE]	= "state",
+	[PHASE_SORT]	= "sort",
+	[PHASE_DEDUP]	= "dedup",
+	[PHASE_OUTPUT]	= "output",
+	[PHASE_STREAM]	= "stream",
+	[PHASE_MAP]	= "map",
+};
+
+static double clock_seconds(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void stats_start(struct stats_timer *t)
+{
+	t->wall = clock_seconds(CLOCK_MONOTONIC);
+	t->cpu = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/* CPU time is the whole process's, so it covers -j worker threads too. */
+void stats_stop(struct stats_timer *t, enum stats_phase phase)
+{
+	kas_stats.phase[phase].wall += clock_seconds(CLOCK_MONOTONIC) - t->wall;
+	kas_stats.phase[phase].cpu += clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - t->cpu;
+}
+
+static void print_text(FILE *fp, long peak_rss_kb)
+{
+	struct phase_time total = {0};
+	int i;
+
+	fprintf(fp, "%-8s %10s %10s\n", "phase", "wall ms", "cpu ms");
+	for (i = 0; i < PHASE_COUNT; i++) {
+		if (!kas_stats.phase[i].wall)
+			continue;
+		fprintf(fp, "%-8s %10.3f %10.3f\n", phase_names[i],
+			kas_stats.phase[i].wall * 1e3, kas_stats.phase[i].cpu * 1e3);
+		total.wall += kas_stats.phase[i].wall;
+		total.cpu += kas_stats.phase[i].cpu;
+	}
+	fprintf(fp, "%-8s %10.3f %10.3f\n", "total", total.wall * 1e3, total.cpu * 1e3);
+
+	fprintf(fp, "symbols %" PRIu64 ", duplicate groups %" PRIu64 " (largest %" PRIu64
+		"), aliases %" PRIu64 "\n", kas_stats.symbols, kas_stats.groups,
+		kas_stats.largest_group, kas_stats.aliases);
+	fprintf(fp, "input %" PRIu64 " bytes, output %" PRIu64 " bytes\n",
+		kas_stats.input_bytes, kas_stats.output_bytes);
+	fprintf(fp, "%" PRIu64 " allocations, %" PRIu64 " bytes, peak RSS %ld KB\n",
+		kas_stats.allocs, kas_stats.alloc_bytes, peak_rss_kb);
+}
+
+/* One object on one line, so build logs can grep it out. */
+static void print_json(FILE *fp, long peak_rss_kb)
+{
+	const char *sep = "";
+	int i;
+
+	fprintf(fp, "{\"phases\":{");
+	for (i = 0; i < PHASE_COUNT; i++) {
+		if (!kas_stats.phase[i].wall)
+			continue;
+		fprintf(fp, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", sep, phase_names[i],
+			kas_stats.phase[i].wall * 1e3, kas_stats.phase[i].cpu * 1e3);
+		sep = ",";
+	}
+	fprintf(fp, "},\"symbols\":%" PRIu64 ",\"duplicate_groups\":%" PRIu64
+		",\"largest_group\":%" PRIu64 ",\"aliases\":%" PRIu64 ",\"input_bytes\":%" PRIu64
+		",\"output_bytes\":%" PRIu64 ",\"allocs\":%" PRIu64 ",\"alloc_bytes\":%" PRIu64
+		",\"peak_rss_kb\":%ld}\n",
+		kas_stats.symbols, kas_stats.groups, kas_stats.largest_group, kas_stats.aliases,
+		kas_stats.input_bytes, kas_stats.output_bytes, kas_stats.allocs,
+		kas_stats.alloc_bytes, peak_rss_kb);
+}
+
+void stats_print(FILE *fp, bool json)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	if (json)
+		print_json(fp, ru.ru_maxrss);
+	else
+		print_text(fp, ru.ru_maxrss);
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+enum stats_phase {
+	PHASE_PARSE,
+	PHASE_STATE,
+	PHASE_SORT,
+	PHASE_DEDUP,
+	PHASE_OUTPUT,
+	PHASE_STREAM,
+	PHASE_MAP,
+	PHASE_COUNT
+};
+
+struct phase_time {
+	double		wall;
+	double		cpu;
+};
+
+/*
+ * What a run cost, for -stats. Phases accumulate, so a phase entered
+ * twice (both sorts of the unordered path) reports the sum.
+ */
+struct kas_stats {
+	struct phase_time	phase[PHASE_COUNT];
+	uint64_t		symbols;
+	uint64_t		groups;
+	uint64_t		aliases;
+	uint64_t		largest_group;
+	uint64_t		input_bytes;
+	uint64_t		output_bytes;
+	uint64_t		allocs;		/* these two are updated from */
+	uint64_t		alloc_bytes;	/* several threads */
+};
+
+struct stats_timer {
+	double		wall;
+	double		cpu;
+};
+
+extern struct kas_stats kas_stats;
+
+void stats_start(struct stats_timer *t);
+void stats_stop(struct stats_timer *t, enum stats_phase phase);
+void stats_print(FILE *fp, bool json);
+
+static inline void stats_alloc(size_t size)
+{
+	__atomic_fetch_add(&kas_stats.allocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&kas_stats.alloc_bytes, size, __ATOMIC_RELAXED);
+}
+#endif
@@ -0,0 +1,63 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Fails every allocation of a run in turn, for each way of driving
+# kas_alias. Each run must either exit 1 with an error or, where a failure
+# is tolerated, succeed with the normal output; anything else, a crash in
+# particular, fails the test.
+#
+# usage: fault_test.sh <main_fault> <nmfile>
+
+prog=$1
+input=$2
+map=$(dirname "$0")/../old/linker_log_samples/6.3.vmlinux.map
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# the legacy path wants input out of address order
+sort -k3 "$input" > "$tmp/unsorted.nm"
+"$prog" "$input" > "$tmp/processed.nm" || exit 1
+printf '!*_show\nstore*\nenable\n' > "$tmp/list"
+printf '%s %s\n' "$input" "$tmp/m1" "$tmp/unsorted.nm" "$tmp/m2" \
+	"$tmp/processed.nm" "$tmp/m3" "$prog" "$tmp/m4" > "$tmp/inputs"
+
+run() {
+	case $1 in
+	sorted)		"$prog" "$input" $2 ;;
+	unsorted)	"$prog" "$tmp/unsorted.nm" $2 ;;
+	stream)		"$prog" - $2 < "$input" ;;
+	state)		rm -f "$tmp/state"; "$prog" "$input" -state "$tmp/state" $2 ;;
+	threads)	"$prog" "$input" -j 4 $2 ;;
+	elf)		"$prog" "$prog" $2 ;;
+	map)		"$prog" "$input" -map "$map" $2 ;;
+	index)		"$prog" "$input" -index "$tmp/index" $2 ;;
+	processed)	"$prog" "$tmp/processed.nm" -binary $2 ;;
+	filter)		"$prog" "$input" -text-only -skip-pfx -alias-list "$tmp/list" $2 ;;
+	multi)		rm -f "$tmp"/m?; "$prog" "$tmp/inputs" -multi -j 2 $2 &&
+			cat "$tmp"/m? ;;
+	esac
+}
+
+failed=0
+for mode in sorted unsorted stream state threads elf map index filter processed multi; do
+	run $mode > "$tmp/ref" 2>/dev/null || { echo "$mode: reference run failed"; exit 1; }
+	allocs=$(run $mode -stats-json 2>&1 >/dev/null | sed -n 's/.*"allocs":\([0-9]*\).*/\1/p')
+	[ -n "$allocs" ] || { echo "$mode: no allocation count"; exit 1; }
+
+	n=1
+	while [ $n -le $allocs ]; do
+		KAS_ALIAS_FAIL_ALLOC=$n run $mode > "$tmp/out" 2>/dev/null
+		rc=$?
+		if [ $rc -eq 0 ] && ! cmp -s "$tmp/out" "$tmp/ref"; then
+			echo "$mode: allocation $n failed, wrong output"
+			failed=1
+		elif [ $rc -ne 0 ] && [ $rc -ne 1 ]; then
+			echo "$mode: allocation $n failed, exit status $rc"
+			failed=1
+		fi
+		n=$((n + 1))
+	done
+	echo "$mode: $allocs allocations failed in turn"
+done
+
+exit $failed
@@ -0,0 +1,179 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Throughput and memory gate, on 250000 generated symbols (address
+# ordered, unordered, from stdin and cut in four for -multi) and on the
+# 6.18 kernel dump of tests/data.
+#
+# Throughput is compared with a reference build measured in the same
+# run, so that it does not depend on the machine: kas_alias is built
+# from the git revision PERF_REF into a scratch tree. Without PERF_REF
+# the reference is the last tag before HEAD, or else the merge base with
+# the upstream branch, and the check fails if there is neither. If the
+# sources do not differ from the reference there is nothing to compare
+# and only memory is checked. Each case runs both builds in turn,
+# PERF_RUNS times each, with -stats-json; the best wall time of each, as
+# million symbols per second, is taken, and the check fails if <main> is
+# more than PERF_TOLERANCE percent slower than the reference.
+#
+# Memory is compared with tests/perf_baseline, which records the bytes
+# allocated per symbol of each case; they depend on the code only. The
+# check fails if a case allocates more than RSS_TOLERANCE percent above
+# it, or if peak RSS grows by more than that over the reference build.
+# With -u the baseline is recorded again, after a change that is meant
+# to use more memory.
+#
+# usage: perf_check.sh [-u] <main> <gen_nm>
+
+# sort and awk must not depend on the locale
+export LC_ALL=C
+
+update=0
+if [ "$1" = -u ]; then
+	update=1
+	shift
+fi
+prog=$1
+gen=$2
+dir=$(dirname "$0")
+baseline=$dir/perf_baseline
+runs=${PERF_RUNS:-5}
+tolerance=${PERF_TOLERANCE:-25}
+rss_tolerance=${RSS_TOLERANCE:-10}
+cases="sorted unsorted stream multi kernel"
+top=$(git -C "$dir" rev-parse --show-toplevel) || exit 1
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+"$gen" -n 250000 -d 5 > "$tmp/sorted.nm" || exit 1
+sort -k3 "$tmp/sorted.nm" > "$tmp/unsorted.nm"
+split -n l/4 "$tmp/sorted.nm" "$tmp/part."
+for p in "$tmp"/part.*; do
+	echo "$p $p.out"
+done > "$tmp/inputs"
+gzip -dc "$dir/data/6.18.kallsyms.gz" > "$tmp/kernel.nm" || exit 1
+
+# run <binary> <case>
+run() {
+	case $2 in
+	sorted)		"$1" "$tmp/sorted.nm" -o /dev/null -stats-json ;;
+	unsorted)	"$1" "$tmp/unsorted.nm" -o /dev/null -stats-json ;;
+	stream)		"$1" - -stats-json < "$tmp/sorted.nm" > /dev/null ;;
+	multi)		"$1" "$tmp/inputs" -multi -stats-json ;;
+	kernel)		"$1" "$tmp/kernel.nm" -o /dev/null -stats-json ;;
+	esac
+}
+
+# best of the runs in a stats file:
+# "<million symbols per second> <peak RSS KB> <allocated bytes per symbol>"
+best() {
+	awk '
+	function field(name) {
+		if (!match($0, "\"" name "\":[0-9]+"))
+			return 0
+		return substr($0, RSTART + length(name) + 3, RLENGTH - length(name) - 3)
+	}
+	{
+		wall = 0
+		s = $0
+		while (match(s, /"wall_ms":[0-9.]+/)) {
+			wall += substr(s, RSTART + 10, RLENGTH - 10)
+			s = substr(s, RSTART + RLENGTH)
+		}
+		syms = field("symbols")
+		rss = field("peak_rss_kb")
+		if (wall > 0 && (!best || syms / wall > best))
+			best = syms / wall
+		if (!low || rss < low)
+			low = rss
+		if (syms)
+			bps = field("alloc_bytes") / syms
+	}
+	END { if (best) printf "%.3f %d %.1f\n", best / 1000, low, bps }' "$1"
+}
+
+# measure <binary> <case> <stats file>: one more run of the case
+measure() {
+	run "$1" $2 2>>"$3" >/dev/null
+}
+
+if [ $update -eq 1 ]; then
+	: > "$tmp/results"
+	for c in $cases; do
+		: > "$tmp/new"
+		measure "$prog" $c "$tmp/new" || { echo "$c: run failed"; exit 1; }
+		echo "$c $(best "$tmp/new" | cut -d' ' -f3)" >> "$tmp/results"
+	done
+	cp "$tmp/results" "$baseline"
+	cat "$baseline"
+	exit 0
+fi
+
+# the reference: PERF_REF, the last tag before HEAD, or the merge base
+ref=$PERF_REF
+[ -n "$ref" ] || ref=$(git -C "$top" describe --tags --abbrev=0 HEAD^ 2>/dev/null)
+[ -n "$ref" ] || ref=$(git -C "$top" merge-base HEAD '@{upstream}' 2>/dev/null)
+if [ -z "$ref" ]; then
+	echo "no reference revision: no tag and no upstream branch, set PERF_REF"
+	exit 1
+fi
+if git -C "$top" diff --quiet "$ref" -- '*.c' '*.h' Makefile; then
+	echo "reference: $ref, same sources: throughput not compared"
+	base=
+else
+	echo "reference: $ref ($(git -C "$top" rev-parse --short "$ref"))"
+	mkdir "$tmp/ref"
+	git -C "$top" archive "$ref" | tar -x -C "$tmp/ref" || exit 1
+	make -s -C "$tmp/ref" main > "$tmp/build.log" 2>&1 || {
+		echo "can't build $ref"
+		cat "$tmp/build.log"
+		exit 1
+	}
+	base=$tmp/ref/main
+fi
+
+failed=0
+for c in $cases; do
+	: > "$tmp/new"
+	: > "$tmp/base"
+	n=0
+	while [ $n -lt $runs ]; do
+		# the two builds take turns, so that both see the same machine load
+		if [ -n "$base" ]; then
+			measure "$base" $c "$tmp/base" || { echo "$c: reference run failed"; exit 1; }
+		fi
+		measure "$prog" $c "$tmp/new" || { echo "$c: run failed"; exit 1; }
+		n=$((n + 1))
+	done
+	want=$(awk -v n=$c '$1 == n { print $2 }' "$baseline")
+	if [ -z "$want" ]; then
+		echo "$c: not in $baseline"
+		failed=1
+		continue
+	fi
+	if [ -n "$base" ]; then
+		ref_m=$(best "$tmp/base")
+	else
+		ref_m=$(best "$tmp/new")
+	fi
+	echo "$c $(best "$tmp/new") $ref_m $want" | awk -v t=$tolerance -v r=$rss_tolerance \
+		-v same=$([ -n "$base" ] && echo 0 || echo 1) '{
+		printf "%-9s %8.3f Msym/s (reference %.3f)  %7d KB (reference %d)  %6.1f B/sym (baseline %.1f)\n",
+		       $1, $2, $5, $3, $6, $4, $8
+		bad = 0
+		if (!same && $2 < $5 * (100 - t) / 100) {
+			printf "%s: throughput %.1f%% below reference\n", $1, 100 - 100 * $2 / $5
+			bad = 1
+		}
+		if (!same && $3 > $6 * (100 + r) / 100) {
+			printf "%s: peak RSS %.1f%% above reference\n", $1, 100 * $3 / $6 - 100
+			bad = 1
+		}
+		if ($4 > $8 * (100 + r) / 100) {
+			printf "%s: %.1f%% more bytes per symbol than the baseline\n", $1, 100 * $4 / $8 - 100
+			bad = 1
+		}
+		exit bad
+	}' || failed=1
+done
+exit $failed